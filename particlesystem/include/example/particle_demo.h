@@ -14,24 +14,79 @@ enum class PlacementMode {
     UniformEmitter,
     DirectionalEmitter,
     ExplosionEmitter,
+    RingEmitter,
     GravityWell,
     Wind
 };
 
+// Everything the renderer needs to draw one simulated frame
+struct RenderFrame {
+    // Particle rendering data
+    std::vector<glm::vec2> positions;
+    std::vector<glm::vec4> colors;
+    std::vector<float> sizes;
+
+    // Marker rendering data for emitters and effects
+    std::vector<glm::vec2> markerPositions;
+    std::vector<glm::vec4> markerColors;
+    std::vector<float> markerSizes;
+};
+
 class ParticleDemo {
 public:
     ParticleDemo();
     ~ParticleDemo() = default;
     
     // Update the demo with time and mouse position
+    // The result is published as a new render frame, see acquireFrame()
     void update(double time, float dt, const glm::vec2& mousePos);
     
-    // Get particle data for rendering
+    // Take the most recently published frame for rendering. This never blocks and may be
+    // called from a different thread than update(), but only from one thread at a time.
+    const RenderFrame& acquireFrame();
+    
+    // Choose whether update() copies the particles into the render frame. Without the copy
+    // the particles are drawn straight from getSystem(), which is only safe while update()
+    // and drawing never overlap, i.e. when the simulation is not pipelined.
+    void setSnapshotParticles(bool snapshot);
+    
+    // Limit the number of particles in the render frame, 0 for no limit.
+    // See ParticleSystem::setRenderBudget.
+    void setRenderBudget(size_t budget);
+    
+    // Only render particles inside the box [min, max], see ParticleSystem::setCullRect
+    void setCullRect(const glm::vec2& min, const glm::vec2& max);
+    
+    // Most particles emitters may add to, see ParticleSystem::setMaxParticles
+    void setMaxParticles(size_t max);
+    
+    // Number of threads running the emitters, see ParticleSystem::setThreadCount
+    void setThreadCount(size_t count);
+    
+    // The simulated particle system, valid to read between calls to update()
+    const ps::ParticleSystem& getSystem() const;
+    
+    // Replaces all emitters and effects with the ones listed in a scene file. Every line
+    // holds a type, a position and an optional value, e.g. "uniform 0.0 0.5 200":
+    //   uniform|directional|ring x y [rate]   explosion x y [particle count]
+    //   gravitywell|wind x y [strength]
+    // Empty lines and lines starting with # are ignored. Throws std::runtime_error if the
+    // file cannot be read or a line is malformed.
+    void loadScene(const std::string& path);
+    
+    // Seed of all current and future emitters, emitters keep their own random streams
+    void setSeed(uint64_t seed);
+    
+    // Spawns count particles spread over the bounds with the given lifetime, drawn from
+    // the seed, e.g. to start a run with a fixed load
+    void addParticles(size_t count, float lifetime, uint64_t seed);
+    
+    // Get particle data for rendering from the last acquired frame
     const std::vector<glm::vec2>& getPositions() const;
     const std::vector<glm::vec4>& getColors() const;
     const std::vector<float>& getSizes() const;
     
-    // Get marker data for rendering emitters and effects
+    // Get marker data for rendering emitters and effects from the last acquired frame
     const std::vector<glm::vec2>& getMarkerPositions() const;
     const std::vector<glm::vec4>& getMarkerColors() const;
     const std::vector<float>& getMarkerSizes() const;
@@ -46,6 +101,7 @@ private:
     void createUniformEmitter(const glm::vec2& position);
     void createDirectionalEmitter(const glm::vec2& position);
     void createExplosionEmitter(const glm::vec2& position);
+    void createRingEmitter(const glm::vec2& position);
     void createGravityWell(const glm::vec2& position);
     void createWind(const glm::vec2& position);
     
@@ -53,23 +109,13 @@ private:
     void selectObjectAtPosition(const glm::vec2& position);
     
     // Update the marker positions and colors
-    void updateMarkers();
-    
-    // Helper method to keep particles within bounds
-    void keepParticlesWithinBounds();
+    void updateMarkers(RenderFrame& frame);
     
     // The particle system
     ps::ParticleSystem system_;
     
-    // Particle rendering data
-    std::vector<glm::vec2> positions_;
-    std::vector<glm::vec4> colors_;
-    std::vector<float> sizes_;
-    
-    // Marker rendering data for emitters and effects
-    std::vector<glm::vec2> markerPositions_;
-    std::vector<glm::vec4> markerColors_;
-    std::vector<float> markerSizes_;
+    // Rendering data, written by update() and read by the renderer
+    ps::TripleBuffer<RenderFrame> frames_;
     
     // Emitters
     std::vector<std::shared_ptr<ps::Emitter>> emitters_;
@@ -84,6 +130,16 @@ private:
     enum class SelectedType { None, Emitter, Effect } selectedType_;
     size_t selectedIndex_;
     
+    // Copy particle columns into each render frame
+    bool snapshotParticles_;
+    
+    // Seed given to new emitters
+    uint64_t seed_;
+    
+    // Random stream of the next emitter, counted per demo so that a scene gives the same
+    // particles no matter how many emitters were created before it
+    uint32_t nextStream_;
+    
     // Colors for different emitter/effect types
     static constexpr glm::vec4 UNIFORM_EMITTER_COLOR = {0.2f, 0.8f, 0.2f, 1.0f};
     static constexpr glm::vec4 DIRECTIONAL_EMITTER_COLOR = {0.2f, 0.2f, 0.8f, 1.0f};
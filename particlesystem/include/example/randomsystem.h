@@ -2,9 +2,9 @@
 
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
+#include <particlesystem/random.h>
 
 #include <vector>
-#include <random>
 #include <span>
 
 namespace example {
@@ -44,18 +44,15 @@ private:
     std::vector<glm::vec4> color;
     std::vector<float> lifetime;
 
-    glm::vec2 randPosition() { return {positionDist(gen), positionDist(gen)}; };
-    float randSize() { return sizeDist(gen); };
-    glm::vec4 randColor() { return {colorDist(gen), colorDist(gen), colorDist(gen), 0.5f}; };
-    float randLifetime() { return lifetimeDist(gen); };
-    glm::vec2 randJitter() { return {positionDist(gen), positionDist(gen)}; };
-
-    std::mt19937 gen;
-    std::uniform_real_distribution<float> positionDist;
-    std::uniform_real_distribution<float> sizeDist;
-    std::uniform_real_distribution<float> colorDist;
-    std::uniform_real_distribution<float> lifetimeDist;
-    std::uniform_real_distribution<float> jitterDist;
+    glm::vec2 randPosition() { return {gen.next(-1.0f, 1.0f), gen.next(-1.0f, 1.0f)}; };
+    float randSize() { return gen.next(1.0f, 10.0f); };
+    glm::vec4 randColor() { return {gen.next(), gen.next(), gen.next(), 0.5f}; };
+    float randLifetime() { return gen.next(0.5f, 2.5f); };
+    // Fills the jitter of all particles in one batch
+    void randJitter(std::span<glm::vec2> out) { gen.uniform(out, {-1.0f, -1.0f}, {1.0f, 1.0f}); };
+
+    particlesystem::BatchRng gen;
+    std::vector<glm::vec2> jitter;  // Scratch space for the per particle jitter
     
     double prevTime;
 };
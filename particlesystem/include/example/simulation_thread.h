@@ -0,0 +1,53 @@
+#pragma once
+
+#include <example/particle_demo.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <glm/vec2.hpp>
+
+namespace example {
+
+/**
+ * Runs ParticleDemo::update on a dedicated worker thread so that the simulation of the
+ * next frame overlaps with rendering of the current one.
+ *
+ * A typical frame looks like:
+ *   wait()          - the previous simulation step is done, the demo may be modified
+ *   ... UI input ...
+ *   kick(...)       - start simulating the next frame
+ *   acquireFrame()  - draw the last published frame while the worker is busy
+ */
+class SimulationThread {
+public:
+    explicit SimulationThread(ParticleDemo& demo);
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+    ~SimulationThread();
+
+    // Start updating the demo on the worker thread. Waits for any step still in flight.
+    void kick(double time, float dt, const glm::vec2& mousePos);
+
+    // Block until the last started step has finished and its frame has been published.
+    // Returns immediately if no step is in flight.
+    void wait();
+
+private:
+    void run();
+
+    ParticleDemo& demo_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool pending_;
+    bool stop_;
+
+    // Arguments for the next update, guarded by mutex_
+    double time_;
+    float dt_;
+    glm::vec2 mousePos_;
+
+    std::thread thread_;
+};
+
+}  // namespace example
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * Walker/Vose alias table for sampling from a discrete distribution in constant time.
+ * Building the table is O(n); every sample afterwards costs one table lookup and one
+ * comparison, independent of the number of entries.
+ */
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    /**
+     * Builds the table from non-negative weights. Negative weights count as zero.
+     * If all weights are zero the table is empty.
+     */
+    void build(std::span<const float> weights);
+
+    /**
+     * Picks an index with probability proportional to its weight.
+     * column and coin are independent uniform numbers in [0, 1).
+     * Must not be called on an empty table.
+     */
+    size_t sample(float column, float coin) const {
+        const size_t count = probability_.size();
+        size_t i = static_cast<size_t>(column * static_cast<float>(count));
+        i = i < count ? i : count - 1;
+        return coin < probability_[i] ? i : alias_[i];
+    }
+
+    size_t size() const { return probability_.size(); }
+    bool empty() const { return probability_.empty(); }
+
+private:
+    std::vector<float> probability_;  // Chance of keeping column i
+    std::vector<uint32_t> alias_;     // Index used otherwise
+};
+
+} // namespace particlesystem
@@ -8,17 +8,32 @@
 #include <particlesystem/particle.h>
 #include <particlesystem/particlesystem.h>
 #include <particlesystem/transform.hpp>
+#include <particlesystem/spawn_queue.h>
+#include <particlesystem/random.h>
+#include <particlesystem/low_discrepancy.h>
+#include <particlesystem/stats.h>
+#include <particlesystem/trace.h>
+#include <particlesystem/worker_pool.h>
 
 // Emitters - objects that create particles
 #include <particlesystem/emitter.h>
 #include <particlesystem/uniform_emitter.h>
 #include <particlesystem/directional_emitter.h>
 #include <particlesystem/explosion_emitter.h>
+#include <particlesystem/shape_emitter.h>
+#include <particlesystem/line_emitter.h>
+#include <particlesystem/ring_emitter.h>
+#include <particlesystem/polygon_emitter.h>
+#include <particlesystem/mask_emitter.h>
 
 // Effects - objects that modify particle behavior
 #include <particlesystem/effect.h>
 #include <particlesystem/gravity_well.h>
 #include <particlesystem/wind.h>
 
+// Utilities - helpers for running the simulation alongside other threads
+#include <particlesystem/triple_buffer.h>
+#include <particlesystem/alias_table.h>
+
 // Convenience namespace
 namespace ps = particlesystem; 
\ No newline at end of file
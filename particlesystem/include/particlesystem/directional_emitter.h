@@ -1,7 +1,6 @@
 #pragma once
 
 #include <particlesystem/emitter.h>
-#include <random>
 
 namespace particlesystem {
 
@@ -24,8 +23,8 @@ public:
     // Set the lifetime range for emitted particles
     void setLifetimeRange(float minLifetime, float maxLifetime);
 
-    // Implementation of the emit method
-    void emit(std::vector<Particle>& particles, float dt) override;
+    // Implementation of the generate method
+    void generate(std::span<Particle> particles) override;
 
 private:
     glm::vec2 direction_;
@@ -34,12 +33,6 @@ private:
     float maxSpeed_;
     float minLifetime_;
     float maxLifetime_;
-    
-    // Random number generation
-    std::mt19937 generator_;
-    std::uniform_real_distribution<float> spreadDistribution_;
-    std::uniform_real_distribution<float> speedDistribution_;
-    std::uniform_real_distribution<float> lifetimeDistribution_;
 };
 
 } // namespace particlesystem 
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <particlesystem/particle.h>
+#include <particlesystem/random.h>
+#include <particlesystem/low_discrepancy.h>
+#include <array>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include <glm/vec2.hpp>
 
@@ -40,16 +45,84 @@ public:
      */
     float getRate() const;
 
+    /**
+     * Sets the seed used for all random numbers drawn by this emitter.
+     * Emitters with the same seed, stream and settings produce identical particles.
+     */
+    void setSeed(uint64_t seed);
+    uint64_t getSeed() const;
+    
+    /**
+     * Sets the random stream of this emitter.
+     * Every emitter gets a unique stream on construction so that emitters sharing a seed
+     * still produce different particles.
+     */
+    void setStream(uint32_t stream);
+    uint32_t getStream() const;
+
+    /**
+     * Selects how random numbers are drawn for new particles.
+     * LowDiscrepancy spreads angle, speed, lifetime and position offsets evenly, so fewer
+     * particles are needed for the same visual coverage. Random is the default.
+     */
+    void setSamplingMode(SamplingMode mode);
+    SamplingMode getSamplingMode() const;
+
     /**
      * Emits particles according to the emitter's pattern.
+     * New particles are appended to the given staging buffer, which is owned by this
+     * emitter for the duration of the call. Emitters may run on different threads, so an
+     * implementation must only touch its own state and the buffer it is given.
+     * The default implementation is the bulk path: it asks spawnCount() how many particles
+     * to create, grows the buffer once and lets generate() fill all new particles at once.
+     */
+    virtual void emit(std::vector<Particle>& particles, float dt);
+
+    /**
+     * Upper limit for the number of particles created in a single emission.
+     * A higher rate is cut to this many particles per update.
+     */
+    static constexpr size_t maxSpawnCount = 10000;
+    
+    /**
+     * Computes how many particles to spawn for a time step of dt in O(1).
+     * Consumes the corresponding time from the accumulator.
+     */
+    virtual size_t spawnCount(float dt);
+    
+    /**
+     * Initializes a batch of newly spawned particles.
+     * Particle i of the batch should use the random numbers for index i of the current frame.
      * Must be implemented by derived classes.
      */
-    virtual void emit(std::vector<Particle>& particles, float dt) = 0;
+    virtual void generate(std::span<Particle> particles) = 0;
 
 protected:
+    /**
+     * Draws four numbers in [0, 1) for each of count particles into samples_, using the
+     * current sampling mode. By convention the dimensions are used for the angle, speed,
+     * lifetime and position offset, in that order.
+     */
+    void sample(size_t count);
+    
+    /**
+     * Calls sample(count) and computes unit vectors for angles mapped from samples_[i][0]
+     * onto [minAngle, maxAngle).
+     */
+    void sampleDirections(size_t count, float minAngle, float maxAngle);
+    
     glm::vec2 position_;     // Position of the emitter
     float rate_;             // Emission rate in particles per second
     float accumulator_;      // Accumulates time to control emission rate
+    CounterRng rng_;         // Random numbers keyed by (seed, stream, frame, particle index)
+    uint32_t frame_;         // Advanced after every emission, used as the random frame counter
+    SamplingMode samplingMode_;
+    LowDiscrepancySequence sequence_;  // Scrambled with the same seed and stream as rng_
+    
+    // Scratch space for batched sampling, reused between emissions
+    std::vector<std::array<float, 4>> samples_;
+    std::vector<float> angles_;
+    std::vector<glm::vec2> directions_;
 };
 
 } // namespace particlesystem 
\ No newline at end of file
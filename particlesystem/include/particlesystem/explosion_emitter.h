@@ -1,7 +1,6 @@
 #pragma once
 
 #include <particlesystem/emitter.h>
-#include <random>
 
 namespace particlesystem {
 
@@ -26,8 +25,11 @@ public:
     // Trigger the explosion
     void trigger();
     
-    // Implementation of the emit method
-    void emit(std::vector<Particle>& particles, float dt) override;
+    // Emits the whole explosion once after it has been triggered
+    size_t spawnCount(float dt) override;
+    
+    // Implementation of the generate method
+    void generate(std::span<Particle> particles) override;
 
 private:
     int particleCount_;
@@ -36,12 +38,6 @@ private:
     float minLifetime_;
     float maxLifetime_;
     bool triggered_;
-    
-    // Random number generation
-    std::mt19937 generator_;
-    std::uniform_real_distribution<float> angleDistribution_;
-    std::uniform_real_distribution<float> speedDistribution_;
-    std::uniform_real_distribution<float> lifetimeDistribution_;
 };
 
 } // namespace particlesystem 
\ No newline at end of file
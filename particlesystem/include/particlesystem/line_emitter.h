@@ -0,0 +1,28 @@
+#pragma once
+
+#include <particlesystem/shape_emitter.h>
+
+namespace particlesystem {
+
+/**
+ * Emits particles uniformly along a polyline, with points relative to the emitter position.
+ * Longer segments receive proportionally more particles.
+ */
+class LineEmitter : public ShapeEmitter {
+public:
+    LineEmitter(const glm::vec2& position, std::vector<glm::vec2> points, bool closed = false);
+    ~LineEmitter() override = default;
+
+    // Set the polyline; a closed polyline also connects the last point to the first
+    void setPoints(std::vector<glm::vec2> points, bool closed = false);
+    const std::vector<glm::vec2>& getPoints() const;
+    bool isClosed() const;
+
+private:
+    void rebuild();
+
+    std::vector<glm::vec2> points_;
+    bool closed_;
+};
+
+} // namespace particlesystem
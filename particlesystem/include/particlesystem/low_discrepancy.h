@@ -0,0 +1,63 @@
+#pragma once
+
+#include <particlesystem/random.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace particlesystem {
+
+/**
+ * How an emitter draws the random numbers for its particles.
+ */
+enum class SamplingMode {
+    Random,          // Independent white noise samples, see CounterRng
+    LowDiscrepancy   // Evenly spread samples from a scrambled Halton sequence
+};
+
+/**
+ * Scrambled 4D Halton sequence (bases 2, 3, 5, 7) backed by a precomputed table.
+ * Consecutive points cover the unit hypercube evenly, without the clumps and gaps of
+ * independent random samples. Every instance applies its own random toroidal shift
+ * (Cranley-Patterson rotation), so emitters sharing the table are decorrelated. A new
+ * shift is drawn each time the table wraps around.
+ */
+class LowDiscrepancySequence {
+public:
+    static constexpr size_t dimensions = 4;
+    static constexpr size_t tableSize = 4096;
+
+    using Point = std::array<float, dimensions>;
+
+    /**
+     * Creates a sequence scrambled with the given seed and stream.
+     */
+    explicit LowDiscrepancySequence(uint64_t seed = CounterRng::defaultSeed, uint32_t stream = 0);
+
+    /**
+     * Changes the scrambling and restarts the sequence.
+     */
+    void scramble(uint64_t seed, uint32_t stream);
+
+    /**
+     * Fills \p out with the next points of the sequence, each coordinate in [0, 1).
+     */
+    void next(std::span<Point> out);
+
+    /**
+     * The unscrambled points shared by all sequences.
+     */
+    static const std::array<Point, tableSize>& table();
+
+private:
+    // Draws the shift used for the given pass over the table
+    void updateOffset();
+
+    CounterRng rng_;
+    Point offset_;
+    uint32_t index_;  // Position in the table
+    uint32_t cycle_;  // Number of completed passes over the table
+};
+
+} // namespace particlesystem
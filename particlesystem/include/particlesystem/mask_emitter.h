@@ -0,0 +1,39 @@
+#pragma once
+
+#include <particlesystem/shape_emitter.h>
+
+namespace particlesystem {
+
+/**
+ * Emits particles from the pixels of a grayscale mask, e.g. a logo or a text bitmap.
+ * Each pixel covers a square cell and receives particles in proportion to its value.
+ * The mask is centered on the emitter position with row 0 at the top.
+ */
+class MaskEmitter : public ShapeEmitter {
+public:
+    /**
+     * Creates an emitter from width * height mask values stored row by row.
+     * cellSize is the side length of one pixel in world units.
+     */
+    MaskEmitter(const glm::vec2& position, int width, int height, std::vector<float> mask,
+                float cellSize);
+    ~MaskEmitter() override = default;
+
+    void setMask(int width, int height, std::vector<float> mask);
+    const std::vector<float>& getMask() const;
+    int getWidth() const;
+    int getHeight() const;
+
+    void setCellSize(float cellSize);
+    float getCellSize() const;
+
+private:
+    void rebuild();
+
+    int width_;
+    int height_;
+    std::vector<float> mask_;
+    float cellSize_;
+};
+
+} // namespace particlesystem
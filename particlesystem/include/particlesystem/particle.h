@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/vec2.hpp>
+#include <cstdint>
 
 namespace particlesystem {
 
@@ -23,6 +24,7 @@ public:
     glm::vec2 force;     // Current accumulated force acting on the particle
     float lifetime;      // Remaining lifetime in seconds
     bool alive;          // Whether the particle is active in the simulation
+    uint32_t id;         // Identity given by the system on spawn, kept for the whole life
 
     /**
      * Updates the particle state for a time step.
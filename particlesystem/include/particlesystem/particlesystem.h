@@ -3,8 +3,12 @@
 #include <particlesystem/particle.h>
 #include <particlesystem/emitter.h>
 #include <particlesystem/effect.h>
+#include <particlesystem/spawn_queue.h>
+#include <particlesystem/stats.h>
+#include <particlesystem/worker_pool.h>
 #include <vector>
 #include <memory>
+#include <span>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 
@@ -48,6 +52,31 @@ public:
      */
     void removeEffect(std::shared_ptr<Effect> effect);
     
+    /**
+     * Gets the queue for spawning particles from other threads.
+     * Submitted particles are added at the start of the next update.
+     */
+    SpawnQueue& getSpawnQueue();
+    
+    /**
+     * Limits the number of particles, so emitters cannot grow the system without bound.
+     * Emitters only add particles while there are fewer than max, earlier emitters first.
+     * Particles given through setParticles or the spawn queue are always added.
+     * Defaults to defaultMaxParticles.
+     */
+    void setMaxParticles(size_t max);
+    size_t getMaxParticles() const;
+    static constexpr size_t defaultMaxParticles = 10000;
+    
+    /**
+     * Sets the number of threads used to run the emitters.
+     * Each emitter writes into its own staging buffer, so emitters can run in parallel.
+     * A count of 1 (the default) runs everything on the calling thread. The threads are
+     * started here and kept between updates.
+     */
+    void setThreadCount(size_t count);
+    size_t getThreadCount() const;
+    
     /**
      * Gets read-only access to the particles.
      * Returns const reference to the particles vector.
@@ -63,9 +92,81 @@ public:
     /**
      * Gets particle data for rendering.
      * Fills the provided vectors with position, color and size data.
+     * Prefer the span accessors below when the data does not need to outlive the next update.
      */
     void getParticleData(std::vector<glm::vec2>& positions, std::vector<glm::vec4>& colors, std::vector<float>& sizes) const;
     
+    /**
+     * Read-only views of the render columns, in particle order.
+     * The columns hold the live particles that pass the cull rect, or the subset of those
+     * chosen by the render budget.
+     * They are written during update() and stay valid until the next call that modifies
+     * the particles.
+     */
+    std::span<const glm::vec2> getPositions() const;
+    std::span<const glm::vec4> getColors() const;
+    std::span<const float> getSizes() const;
+    
+    /**
+     * Timings and counters of the last update, see UpdateStats.
+     * Everything stays zero unless the library is built with PARTICLESYSTEM_STATS.
+     */
+    const UpdateStats& stats() const;
+    
+    /**
+     * Memory held by the particle storage after the last update, see MemoryStats.
+     */
+    const MemoryStats& memoryStats() const;
+    
+    /**
+     * Gets the number of live particles.
+     */
+    size_t getAliveCount() const;
+    
+    /**
+     * Gets the number of rendered particles, which is the length of every render column.
+     */
+    size_t getRenderCount() const;
+    
+    /**
+     * Limits the number of particles written to the render columns, 0 (the default) for
+     * no limit.
+     * Above the budget, exactly budget particles are kept by priority sampling: each particle
+     * draws a number u from a hash of its id and the particles with the smallest
+     * u / importance (alpha times size) are kept. The same particles are kept from frame to
+     * frame without flicker, and particles that spawn or die only change the choice at the
+     * margin. Kept particles are made more opaque, and larger once fully opaque, so the
+     * image keeps its density.
+     */
+    void setRenderBudget(size_t budget);
+    size_t getRenderBudget() const;
+    
+    /**
+     * Leaves particles outside the box [min, max] out of the render columns, e.g. the
+     * area seen by the camera grown by the largest particle radius.
+     * Bounds are kept for every block of cullBlockSize particles while they are updated,
+     * so blocks entirely outside or inside the box are handled without testing each particle.
+     * Blocks are runs of particles in spawn order, not regions of space: the shortcuts pay
+     * off when particles spawned together stay close, such as a few local emitters. When
+     * consecutive particles are scattered over the screen every block spans it, and each
+     * particle is tested on its own.
+     * The render budget only counts particles that pass the test.
+     */
+    void setCullRect(const glm::vec2& min, const glm::vec2& max);
+    void clearCullRect();
+    bool hasCullRect() const;
+    
+    static constexpr size_t cullBlockSize = 1024;
+    
+    /**
+     * Keeps particles inside the box [min, max].
+     * Particles crossing a wall are put back on it and bounce with their velocity scaled
+     * by restitution. Bounds are applied in the same pass that integrates the particles.
+     */
+    void setBounds(const glm::vec2& min, const glm::vec2& max, float restitution);
+    void clearBounds();
+    bool hasBounds() const;
+    
     /**
      * Pre-allocate capacity for particles.
      */
@@ -87,9 +188,79 @@ public:
     void clearEffects();
 
 private:
+    // Appends all staged and queued particles in one bulk operation
+    void mergeSpawns();
+    
+    // Moves and ages the particles, removes dead ones and writes the render columns
+    void integrate(float dt);
+    
+    // Reflects a particle that has left the bounds back inside
+    void bounce(Particle& particle) const;
+    
+    // Rewrites the render columns from particles_
+    void refreshRenderData();
+    
+    // Box around the positions of one block of the render columns
+    struct Bounds {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+    
+    // Grows the bounds of the block holding render column entry index
+    void growBlockBounds(size_t index, const glm::vec2& position);
+    
+    // Removes particles outside the cull rect from the render columns
+    void applyCullRect();
+    
+    // Reduces the render columns to the render budget
+    void applyRenderBudget();
+    
+    // Moves render column entry from to index to, keeping the order
+    void moveRenderEntry(size_t from, size_t to);
+    
+    // Reads the sizes and capacities of all storage into memory_
+    void updateMemoryStats();
+    
     std::vector<Particle> particles_;
+    
+    // Render columns, one entry per live particle
+    std::vector<glm::vec2> positions_;
+    std::vector<glm::vec4> colors_;
+    std::vector<float> sizes_;
+    std::vector<uint32_t> ids_;
+    size_t aliveCount_;
+    size_t maxParticles_;
+    size_t renderBudget_;
+    
+    // Sampling key and render column index of every particle, reused by applyRenderBudget
+    struct BudgetKey {
+        float key;
+        uint32_t index;
+    };
+    std::vector<BudgetKey> budgetKeys_;
+    
+    // Id given to the next spawned particle
+    uint32_t nextId_;
+    
+    bool culled_;
+    Bounds cullRect_;
+    std::vector<Bounds> blockBounds_;
+    
+    bool bounded_;
+    glm::vec2 boundsMin_;
+    glm::vec2 boundsMax_;
+    float restitution_;
+    
     std::vector<std::shared_ptr<Emitter>> emitters_;
     std::vector<std::shared_ptr<Effect>> effects_;
+    
+    // Per-emitter staging buffers for newly emitted particles
+    std::vector<std::vector<Particle>> staging_;
+    SpawnQueue spawnQueue_;
+    WorkerPool workers_;
+    
+    UpdateStats stats_;
+    MemoryStats memory_;
 };
 
 } // namespace particlesystem
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <particlesystem/shape_emitter.h>
+
+namespace particlesystem {
+
+/**
+ * Emits particles uniformly over the inside of a simple polygon, or along its outline.
+ * Vertices are relative to the emitter position and may be given in either winding order.
+ * The polygon is triangulated by ear clipping whenever it changes, so concave shapes work.
+ */
+class PolygonEmitter : public ShapeEmitter {
+public:
+    PolygonEmitter(const glm::vec2& position, std::vector<glm::vec2> vertices);
+    ~PolygonEmitter() override = default;
+
+    void setVertices(std::vector<glm::vec2> vertices);
+    const std::vector<glm::vec2>& getVertices() const;
+
+    // Emit from the edges instead of the area
+    void setOutline(bool outline);
+    bool getOutline() const;
+
+private:
+    void rebuild();
+
+    std::vector<glm::vec2> vertices_;
+    bool outline_;
+};
+
+} // namespace particlesystem
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <glm/vec2.hpp>
+
+/**
+ * @file random.h
+ * @brief Counter-based random number generation for the particle system.
+ *
+ * Instead of advancing a sequential engine, every random number is a pure function of
+ * (seed, stream, frame, index). Emitters use their stream id, the frame number and the
+ * index of the particle within the frame, so the same particles are produced no matter
+ * how many threads emit them or in which order the emitters run.
+ *
+ * For bulk work that does not need to be reproducible per element, BatchRng runs several
+ * xoshiro128+ generators side by side and fills whole arrays at once.
+ */
+
+namespace particlesystem {
+
+/**
+ * @brief The Philox4x32-10 block function (Salmon et al., "Parallel Random Numbers: As Easy
+ * as 1, 2, 3", SC'11).
+ *
+ * @param counter The 128-bit counter to encrypt
+ * @param key The 64-bit key
+ * @return Four 32-bit random words
+ */
+inline std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter,
+                                          std::array<uint32_t, 2> key) {
+    constexpr uint32_t M0 = 0xD2511F53u;
+    constexpr uint32_t M1 = 0xCD9E8D57u;
+    constexpr uint32_t W0 = 0x9E3779B9u;
+    constexpr uint32_t W1 = 0xBB67AE85u;
+
+    for (int round = 0; round < 10; ++round) {
+        const uint64_t p0 = static_cast<uint64_t>(M0) * counter[0];
+        const uint64_t p1 = static_cast<uint64_t>(M1) * counter[2];
+        const uint32_t hi0 = static_cast<uint32_t>(p0 >> 32);
+        const uint32_t lo0 = static_cast<uint32_t>(p0);
+        const uint32_t hi1 = static_cast<uint32_t>(p1 >> 32);
+        const uint32_t lo1 = static_cast<uint32_t>(p1);
+
+        counter = {hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0};
+        key[0] += W0;
+        key[1] += W1;
+    }
+    return counter;
+}
+
+/**
+ * @brief Converts 32 random bits to a float uniformly distributed in [0, 1).
+ */
+inline float toUnitFloat(uint32_t bits) {
+    // Use the top 24 bits, which is all a float mantissa can represent exactly
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief Stateless random number service mapping (seed, stream, frame, index) to numbers.
+ *
+ * Copies are cheap and independent; nothing is mutated when drawing numbers, so a single
+ * instance can be shared between threads.
+ */
+class CounterRng {
+public:
+    static constexpr uint64_t defaultSeed = 0x5EED5EED2024ull;
+
+    explicit CounterRng(uint64_t seed = defaultSeed, uint32_t stream = 0)
+        : seed_(seed), stream_(stream) {}
+
+    void setSeed(uint64_t seed) { seed_ = seed; }
+    uint64_t getSeed() const { return seed_; }
+
+    // Streams separate independent users of the same seed, e.g. one stream per emitter
+    void setStream(uint32_t stream) { stream_ = stream; }
+    uint32_t getStream() const { return stream_; }
+
+    /**
+     * @brief Four random 32-bit words for element \p index of \p frame.
+     * Users needing more than four numbers per element can ask for further \p block s.
+     */
+    std::array<uint32_t, 4> bits(uint32_t frame, uint32_t index, uint32_t block = 0) const {
+        return philox4x32({index, frame, stream_, block},
+                          {static_cast<uint32_t>(seed_), static_cast<uint32_t>(seed_ >> 32)});
+    }
+
+    /**
+     * @brief Four independent floats in [0, 1) for element \p index of \p frame.
+     */
+    std::array<float, 4> uniform4(uint32_t frame, uint32_t index, uint32_t block = 0) const {
+        const auto b = bits(frame, index, block);
+        return {toUnitFloat(b[0]), toUnitFloat(b[1]), toUnitFloat(b[2]), toUnitFloat(b[3])};
+    }
+
+    /**
+     * @brief Fills \p out with uniform4(frame, firstIndex + i, block) for every i.
+     * Elements are independent, so the loop vectorizes and can be split between threads.
+     */
+    void uniform4(uint32_t frame, uint32_t firstIndex, std::span<std::array<float, 4>> out,
+                  uint32_t block = 0) const {
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = uniform4(frame, firstIndex + static_cast<uint32_t>(i), block);
+        }
+    }
+
+private:
+    uint64_t seed_;
+    uint32_t stream_;
+};
+
+/**
+ * @brief Fast bulk generator of uniform floats, unit vectors and ranges.
+ *
+ * Runs eight xoshiro128+ generators in lock step with their state stored lane by lane, so
+ * that every step is a handful of vector instructions. Intended for filling arrays; for
+ * reproducible per-particle numbers use CounterRng instead.
+ */
+class BatchRng {
+public:
+    static constexpr size_t lanes = 8;
+
+    explicit BatchRng(uint64_t seed = CounterRng::defaultSeed);
+
+    /**
+     * @brief Restarts all lanes from the given seed.
+     */
+    void seed(uint64_t seed);
+
+    /**
+     * @brief Returns the next single float in [min, max).
+     */
+    float next(float min = 0.0f, float max = 1.0f);
+
+    /**
+     * @brief Fills \p out with floats uniformly distributed in [min, max).
+     */
+    void uniform(std::span<float> out, float min = 0.0f, float max = 1.0f);
+
+    /**
+     * @brief Fills \p out with points uniformly distributed in the box [min, max).
+     */
+    void uniform(std::span<glm::vec2> out, glm::vec2 min, glm::vec2 max);
+
+    /**
+     * @brief Fills \p out with unit vectors (cos, sin) of angles uniform in [minAngle, maxAngle).
+     */
+    void unitVectors(std::span<glm::vec2> out, float minAngle, float maxAngle);
+
+private:
+    // Advances all lanes and returns one float in [0, 1) per lane
+    void step(float* out);
+
+    alignas(32) std::array<uint32_t, lanes> s0_;
+    alignas(32) std::array<uint32_t, lanes> s1_;
+    alignas(32) std::array<uint32_t, lanes> s2_;
+    alignas(32) std::array<uint32_t, lanes> s3_;
+
+    // Leftover numbers for single draws
+    alignas(32) std::array<float, lanes> buffer_;
+    size_t buffered_;
+};
+
+} // namespace particlesystem
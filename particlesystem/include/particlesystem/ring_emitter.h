@@ -0,0 +1,36 @@
+#pragma once
+
+#include <particlesystem/shape_emitter.h>
+
+namespace particlesystem {
+
+/**
+ * Emits particles from a ring centered on the emitter position.
+ * With zero thickness particles start on the circle itself, otherwise anywhere in the
+ * annulus between radius - thickness / 2 and radius + thickness / 2. The circle is
+ * approximated by the given number of segments.
+ */
+class RingEmitter : public ShapeEmitter {
+public:
+    RingEmitter(const glm::vec2& position, float radius, float thickness = 0.0f,
+                int segments = 64);
+    ~RingEmitter() override = default;
+
+    void setRadius(float radius);
+    float getRadius() const;
+
+    void setThickness(float thickness);
+    float getThickness() const;
+
+    void setSegments(int segments);
+    int getSegments() const;
+
+private:
+    void rebuild();
+
+    float radius_;
+    float thickness_;
+    int segments_;
+};
+
+} // namespace particlesystem
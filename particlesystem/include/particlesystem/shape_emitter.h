@@ -0,0 +1,68 @@
+#pragma once
+
+#include <particlesystem/emitter.h>
+#include <particlesystem/alias_table.h>
+
+namespace particlesystem {
+
+/**
+ * Base class for emitters that spawn particles over a shape instead of a single point.
+ * The shape is broken into primitives (segments, parallelograms and triangles) given
+ * relative to the emitter position. Whenever the shape changes an alias table over the
+ * primitive lengths or areas is rebuilt, so each spawn position costs O(1) regardless of
+ * how detailed the shape is. Particles leave in uniformly random directions.
+ */
+class ShapeEmitter : public Emitter {
+public:
+    /**
+     * A point on the primitive is origin + u * edge0 + v * edge1 with u, v in [0, 1).
+     * A segment has a zero edge1; a triangle only covers the half where u + v <= 1.
+     */
+    struct Primitive {
+        glm::vec2 origin;
+        glm::vec2 edge0;
+        glm::vec2 edge1;
+        bool triangle;
+    };
+
+    ShapeEmitter(const glm::vec2& position);
+    ~ShapeEmitter() override = default;
+
+    // Set the speed range for emitted particles
+    void setSpeedRange(float minSpeed, float maxSpeed);
+
+    // Set the lifetime range for emitted particles
+    void setLifetimeRange(float minLifetime, float maxLifetime);
+
+    // Number of primitives the current shape consists of
+    size_t getPrimitiveCount() const;
+
+    // Implementation of the generate method
+    void generate(std::span<Particle> particles) override;
+
+protected:
+    /**
+     * Replaces the shape. weights[i] is the probability mass of primitives[i], normally its
+     * length or area. A shape without positive weights emits from the emitter position.
+     */
+    void setPrimitives(std::vector<Primitive> primitives, std::span<const float> weights);
+
+    /**
+     * Fills positions_ with count positions relative to the emitter. Must be called after
+     * sample(count) since low-discrepancy sampling picks primitives from samples_[i][3].
+     */
+    void samplePositions(size_t count);
+
+    std::vector<glm::vec2> positions_;  // Scratch space for sampled positions
+
+private:
+    float minSpeed_;
+    float maxSpeed_;
+    float minLifetime_;
+    float maxLifetime_;
+    std::vector<Primitive> primitives_;
+    AliasTable table_;
+    std::vector<std::array<float, 4>> positionSamples_;
+};
+
+} // namespace particlesystem
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <particlesystem/particle.h>
+#include <atomic>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * Lock-free multi-producer, single-consumer queue of particles waiting to be spawned.
+ * Any thread can submit batches of particles without taking a lock. The particle system
+ * drains all pending batches once per update and appends them in bulk.
+ */
+class SpawnQueue {
+public:
+    SpawnQueue();
+    SpawnQueue(const SpawnQueue&) = delete;
+    SpawnQueue& operator=(const SpawnQueue&) = delete;
+    ~SpawnQueue();
+
+    /**
+     * Submits a batch of particles to be spawned.
+     * Safe to call from any thread. Prefer large batches over many single particles.
+     */
+    void submit(std::vector<Particle> particles);
+
+    /**
+     * Submits a single particle to be spawned.
+     * Safe to call from any thread.
+     */
+    void push(const Particle& particle);
+
+    /**
+     * Appends all pending particles to the given vector, in submission order per thread.
+     * Returns the number of particles appended.
+     * Must only be called from one thread at a time.
+     */
+    size_t drain(std::vector<Particle>& particles);
+
+    /**
+     * Checks if there are any pending particles.
+     */
+    bool empty() const;
+
+private:
+    struct Batch {
+        std::vector<Particle> particles;
+        Batch* next;
+    };
+
+    std::atomic<Batch*> head_;  // Most recently submitted batch
+};
+
+} // namespace particlesystem
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @file stats.h
+ * @brief Optional instrumentation of ParticleSystem::update.
+ *
+ * Statistics are only collected when the library is built with PARTICLESYSTEM_STATS
+ * (the CMake option of the same name). Otherwise every PS_STATS statement is removed by the
+ * preprocessor and update() runs exactly as without instrumentation.
+ *
+ * MemoryStats only reads the sizes and capacities of the storage at the end of update(), so
+ * it is always collected.
+ */
+
+#ifdef PARTICLESYSTEM_STATS
+#define PS_STATS(...) __VA_ARGS__
+#else
+#define PS_STATS(...)
+#endif
+
+namespace particlesystem {
+
+/**
+ * @brief Timings and counters of the last call to ParticleSystem::update.
+ */
+struct UpdateStats {
+#ifdef PARTICLESYSTEM_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    /**
+     * The phases of update(), in the order they run.
+     */
+    enum Phase {
+        Emit,         // Emitters fill their staging buffers
+        Merge,        // Staged and queued particles are appended
+        ResetForces,  // Forces are cleared
+        Effects,      // Effects add forces
+        Integrate,    // Particles move, bounce, die and the render columns are written
+        Export,       // Render columns are culled and reduced to the render budget
+        PhaseCount
+    };
+    static constexpr std::array<const char*, PhaseCount> phaseNames = {
+        "Emit", "Merge", "Reset forces", "Effects", "Integrate", "Export"};
+
+    std::array<double, PhaseCount> phaseSeconds{};
+
+    // Particles spawned by each emitter, in the order the emitters were added
+    std::vector<size_t> emitterSpawns;
+    // Particles each effect was applied to, in the order the effects were added
+    std::vector<size_t> effectVisits;
+
+    size_t spawned = 0;          // Particles added from emitters and the spawn queue
+    size_t killed = 0;           // Particles that died
+    size_t capacity = 0;         // Capacity of the particle storage after the update
+    size_t capacityChanges = 0;  // Number of times the particle storage has been reallocated
+};
+
+/**
+ * @brief Memory held by one storage column of the particle system.
+ */
+struct ColumnMemory {
+    const char* name = "";
+    size_t size = 0;                // Elements in use
+    size_t capacity = 0;            // Elements allocated
+    size_t bytes = 0;               // Bytes allocated
+    size_t peakBytes = 0;           // Most bytes allocated after any update
+    size_t reallocations = 0;       // Times the storage was reallocated since the previous update
+    size_t totalReallocations = 0;  // Times the storage was reallocated since the system was created
+};
+
+/**
+ * @brief Memory held by the storage of ParticleSystem after the last update.
+ * Reallocations are detected as changes of capacity, so a column growing twice within one
+ * update is counted once.
+ */
+struct MemoryStats {
+    enum Column {
+        Particles,    // Particle state
+        Positions,    // Render columns
+        Colors,
+        Sizes,
+        Ids,
+        BlockBounds,  // Bounds of the blocks tested against the cull rect
+        Staging,      // Emitter staging buffers, all emitters together
+        BudgetKeys,   // Sampling keys of the render budget
+        ColumnCount
+    };
+    static constexpr std::array<const char*, ColumnCount> columnNames = {
+        "Particles", "Positions", "Colors", "Sizes", "Ids", "Block bounds", "Staging",
+        "Budget keys"};
+
+    std::array<ColumnMemory, ColumnCount> columns{};
+    size_t bytes = 0;          // Bytes allocated by all columns
+    size_t peakBytes = 0;      // Most bytes allocated by all columns after any update
+    size_t reallocations = 0;  // Reallocations of all columns since the previous update
+};
+
+/**
+ * @brief Adds the time from construction to destruction to a phase of UpdateStats.
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(double& seconds)
+        : seconds_(seconds), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    double& seconds_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace particlesystem
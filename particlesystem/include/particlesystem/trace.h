@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @file trace.h
+ * @brief Timeline tracing in the Chrome trace event format.
+ *
+ * PS_TRACE_SCOPE("name") records how long the enclosing scope took on the calling thread.
+ * Every thread writes into its own ring buffer without locks, keeping the latest events
+ * once it is full. trace::write produces a JSON file that can be opened in chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * Markers only record while tracing has been started, and cost a single atomic load
+ * otherwise. Building without PARTICLESYSTEM_TRACE (the CMake option of the same name)
+ * removes them altogether.
+ */
+
+#define PS_TRACE_CONCAT_(a, b) a##b
+#define PS_TRACE_CONCAT(a, b) PS_TRACE_CONCAT_(a, b)
+
+#ifdef PARTICLESYSTEM_TRACE
+#define PS_TRACE_SCOPE(name) \
+    const ::particlesystem::trace::Scope PS_TRACE_CONCAT(psTraceScope, __LINE__) { name }
+#else
+#define PS_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+namespace particlesystem::trace {
+
+/**
+ * @brief Starts recording, dropping earlier events.
+ * If \p frames is not zero, recording stops after that many calls to frame() and the trace
+ * is written to \p path.
+ */
+void start(std::string path = {}, size_t frames = 0);
+
+/**
+ * @brief Stops recording, the recorded events are kept until the next start().
+ */
+void stop();
+
+/**
+ * @brief Returns true while recording.
+ */
+inline bool active();
+
+/**
+ * @brief Writes all recorded events as Chrome trace JSON to \p path.
+ * Safe to call while recording, events are never blocked from being written.
+ * Throws std::runtime_error if the file cannot be written.
+ */
+void write(const std::string& path);
+
+/**
+ * @brief Marks the end of a frame, shown as an instant event on the timeline.
+ * When this ends a trace started with a frame count, a trace that cannot be written is
+ * reported on stderr instead of throwing.
+ */
+void frame();
+
+/**
+ * @brief Names the calling thread in the trace.
+ */
+void setThreadName(std::string_view name);
+
+namespace detail {
+extern std::atomic<bool> recording;
+uint64_t now();
+void record(const char* name, uint64_t begin, uint64_t end);
+}  // namespace detail
+
+inline bool active() { return detail::recording.load(std::memory_order_relaxed); }
+
+/**
+ * @brief Records the time from construction to destruction, see PS_TRACE_SCOPE.
+ * \p name must outlive the trace, e.g. a string literal.
+ */
+class Scope {
+public:
+    explicit Scope(const char* name)
+        : name_(active() ? name : nullptr), begin_(name_ ? detail::now() : 0) {}
+    ~Scope() {
+        if (name_) {
+            detail::record(name_, begin_, detail::now());
+        }
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t begin_;
+};
+
+} // namespace particlesystem::trace
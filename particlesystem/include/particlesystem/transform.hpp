@@ -4,6 +4,8 @@
 #include <glm/gtc/constants.hpp>
 #include <cmath>
 #include <algorithm>
+#include <cstddef>
+#include <span>
 
 /**
  * @file transform.hpp
@@ -32,6 +34,49 @@ inline glm::vec2 rotate(const glm::vec2& v, float angle) {
     );
 }
 
+/**
+ * @brief Computes the unit vector (cos(angle), sin(angle)) without calling into libm.
+ *
+ * Uses a quadrant reduction and short polynomials, accurate to better than 1e-6 for angles
+ * within a few turns of zero. The function is branch free so that loops calling it can
+ * be auto-vectorized.
+ *
+ * @param angle The angle in radians
+ * @return The vector (cos(angle), sin(angle))
+ */
+inline glm::vec2 unitVector(float angle) {
+    // Reduce to r in [-pi/4, pi/4] and a quadrant q, angle = q * pi/2 + r
+    const float t = angle * 0.636619772f;  // 2 / pi
+    const int q = static_cast<int>(t + (t >= 0.0f ? 0.5f : -0.5f));
+    const float qf = static_cast<float>(q);
+    const float r = (angle - qf * 1.5703125f) - qf * 4.83826794897e-4f;  // Cody-Waite split of pi/2
+    
+    const float r2 = r * r;
+    const float s = r + r * r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f)));
+    const float c = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f +
+                                                                     r2 * (1.0f / 40320.0f))));
+    
+    // Rotate (c, s) by the quadrant
+    const int quadrant = q & 3;
+    const float cosv = (quadrant & 1) ? s : c;
+    const float sinv = (quadrant & 1) ? c : s;
+    return glm::vec2((quadrant == 1 || quadrant == 2) ? -cosv : cosv,
+                     (quadrant >= 2) ? -sinv : sinv);
+}
+
+/**
+ * @brief Computes unit vectors for a batch of angles, see unitVector().
+ *
+ * @param angles The angles in radians
+ * @param out Receives (cos, sin) for each angle, must be at least as large as \p angles
+ */
+inline void unitVectors(std::span<const float> angles, std::span<glm::vec2> out) {
+    const size_t count = std::min(angles.size(), out.size());
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = unitVector(angles[i]);
+    }
+}
+
 /**
  * @brief Calculates the length (magnitude) of a 2D vector.
  * 
@@ -67,6 +112,17 @@ inline float dot(const glm::vec2& a, const glm::vec2& b) {
     return a.x * b.x + a.y * b.y;
 }
 
+/**
+ * @brief Calculates the 2D cross product (z component of the 3D cross product).
+ * 
+ * @param a The first vector
+ * @param b The second vector
+ * @return Twice the signed area of the triangle spanned by a and b
+ */
+inline float cross(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
 /**
  * @brief Clamps a value between a minimum and maximum.
  * 
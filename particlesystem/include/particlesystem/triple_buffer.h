@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace particlesystem {
+
+/**
+ * Lock-free triple buffer for handing complete frames from one producer thread
+ * to one consumer thread.
+ * The producer always owns a back slot it can write to, the consumer always owns a
+ * front slot it can read from, and the third slot is exchanged atomically between them.
+ * Neither side ever waits for the other; the consumer simply sees the latest frame that
+ * has been published.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+     * Gets the slot the producer is allowed to write to.
+     * Only call this from the producer thread.
+     */
+    T& back() { return slots_[back_]; }
+
+    /**
+     * Publishes the back slot as the latest complete frame.
+     * The producer receives a new back slot to write the next frame into.
+     */
+    void publish() {
+        const uint8_t previous = shared_.exchange(back_ | dirtyBit, std::memory_order_acq_rel);
+        back_ = previous & indexMask;
+    }
+
+    /**
+     * Takes ownership of the latest published frame, if there is one.
+     * Returns true if the front slot was replaced by a newer frame.
+     * Only call this from the consumer thread.
+     */
+    bool acquire() {
+        if ((shared_.load(std::memory_order_relaxed) & dirtyBit) == 0) {
+            return false;
+        }
+        const uint8_t previous = shared_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & indexMask;
+        return true;
+    }
+
+    /**
+     * Gets the slot the consumer currently owns.
+     * Only call this from the consumer thread.
+     */
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t indexMask = 0x3;
+    static constexpr uint8_t dirtyBit = 0x4;
+
+    std::array<T, 3> slots_{};
+    uint8_t back_ = 0;                  // Owned by the producer
+    std::atomic<uint8_t> shared_{1};    // Exchanged between producer and consumer
+    uint8_t front_ = 2;                 // Owned by the consumer
+};
+
+} // namespace particlesystem
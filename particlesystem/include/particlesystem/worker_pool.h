@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace particlesystem {
+
+/**
+ * Fixed set of threads that run parallel loops for the particle system.
+ * The threads are started once and sleep between loops, so running a loop neither starts
+ * threads nor allocates memory.
+ */
+class WorkerPool {
+public:
+    /**
+     * Starts threadCount - 1 threads, the calling thread is the last one.
+     */
+    explicit WorkerPool(size_t threadCount = 1);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Stops the current threads and starts count - 1 new ones.
+     * Must not be called while a loop is running.
+     */
+    void setThreadCount(size_t count);
+
+    /**
+     * Number of threads running a loop, including the calling thread.
+     */
+    size_t threadCount() const;
+
+    /**
+     * Runs f(i) for all i in [0, count) and returns when all calls are done.
+     * Thread t of n handles i = t, t + n, t + 2n, ..., thread 0 being the calling thread.
+     */
+    template <typename F>
+    void parallelFor(size_t count, F&& f) {
+        auto* context = &f;
+        dispatch(count, context, [](void* c, size_t i) {
+            (*static_cast<decltype(context)>(c))(i);
+        });
+    }
+
+private:
+    using Call = void (*)(void* context, size_t index);
+
+    void dispatch(size_t count, void* context, Call call);
+    void start(size_t count);
+    void stop();
+
+    // Runs the indices of the current loop that belong to thread t
+    void runShare(size_t t);
+    void work(size_t t, size_t seen);
+
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable workDone_;
+    size_t generation_;  // Incremented for every loop handed to the threads
+    size_t pending_;     // Threads still working on the current loop
+    bool stopping_;
+
+    // The current loop
+    void* context_;
+    Call call_;
+    size_t count_;
+    size_t participants_;
+};
+
+} // namespace particlesystem
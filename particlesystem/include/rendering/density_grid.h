@@ -0,0 +1,81 @@
+#pragma once
+
+#include <rendering/window.h>
+#include <particlesystem/worker_pool.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rendering {
+
+/**
+ * Screen sized accumulation grid for drawing very large numbers of particles as a density
+ * image instead of as individual points.
+ *
+ * Every particle adds one to the count, its alpha to the weight and its weighted color to
+ * the pixel it falls in.
+ * The tone mapped result shows the mean color of each pixel with a brightness that grows
+ * with the accumulated weight, so its cost after binning depends only on the number of
+ * pixels, not on the number of particles.
+ */
+class DensityGrid {
+public:
+    DensityGrid(int width, int height);
+
+    // Resizes the grid and clears it
+    void resize(int width, int height);
+    int width() const;
+    int height() const;
+
+    // Number of threads used for binning, defaults to the hardware threads. The threads are
+    // kept between calls.
+    void setThreadCount(size_t count);
+    size_t threadCount() const;
+
+    // Bytes allocated for the accumulators, the particle cells and the band lists
+    size_t memoryBytes() const;
+
+    // Clears the grid and bins the particles as seen by the camera, colors are in range [0,1].
+    // Particles outside the screen are ignored.
+    void bin(std::span<const glm::vec2> positions, std::span<const glm::vec4> colors,
+             const Camera2D& camera = {});
+
+    // Number of particles, accumulated weight and mean color of the pixel in column x and
+    // row y, row 0 at the top
+    uint32_t count(int x, int y) const;
+    float weight(int x, int y) const;
+    glm::vec3 meanColor(int x, int y) const;
+
+    // Writes the tone mapped image as 8-bit RGBA values, row by row from the top. The color
+    // is the mean color of the pixel and alpha is 1 - exp(-exposure * weight).
+    // rgba must hold width() * height() * 4 values.
+    void toneMap(std::span<uint8_t> rgba, float exposure) const;
+
+private:
+    int width_;
+    int height_;
+    particlesystem::WorkerPool workers_;
+
+    // Accumulators, one entry per pixel
+    std::vector<uint32_t> count_;
+    std::vector<float> weight_;
+    std::vector<float> red_;
+    std::vector<float> green_;
+    std::vector<float> blue_;
+
+    // Pixel index of every particle from the last bin call, or UINT32_MAX if off screen
+    std::vector<uint32_t> cells_;
+
+    // Particles on screen sorted by band of rows, so that each thread only visits the
+    // particles of its own band. bandStarts_[b] is the start of band b in order_, and
+    // bandOffsets_[t * bands + b] is where the particles of thread t in band b go.
+    std::vector<uint32_t> order_;
+    std::vector<size_t> bandStarts_;
+    std::vector<size_t> bandOffsets_;
+};
+
+}  // namespace rendering
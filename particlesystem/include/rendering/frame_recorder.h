@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rendering {
+
+// File format of recorded frames
+enum class FrameFormat {
+    Raw,  // RGBA bytes, top row first, the size is part of the file name
+    Ppm,  // Binary PPM, alpha is dropped
+    Png   // Uncompressed PNG, quick to write and readable by any viewer
+};
+
+struct RecordingOptions {
+    // Frames are written to <prefix><frame number>.<ppm|png>, or <prefix><frame number>_<width>x<height>.raw
+    std::string prefix;
+    FrameFormat format = FrameFormat::Png;
+
+    // Most frames waiting for the writer thread
+    size_t queueSize = 8;
+
+    // Drop frames while the queue is full so the caller never waits for the disk. Turn it
+    // off to keep every frame, e.g. for offline rendering.
+    bool dropWhenFull = true;
+};
+
+struct RecordingStats {
+    size_t captured = 0;       // Frames handed to the recorder
+    size_t written = 0;        // Frames written to disk
+    size_t dropped = 0;        // Frames lost because the queue or readback was full
+    size_t failed = 0;         // Frames that could not be written
+    size_t queueDepth = 0;     // Frames waiting for the writer right now
+    size_t maxQueueDepth = 0;  // Largest queue depth seen
+    size_t bufferBytes = 0;    // Frame memory queued or kept for reuse
+};
+
+// Writes frames to image files on a background thread.
+// Frames are passed through a bounded queue, so encoding and disk I/O happen off the render
+// thread. Memory of written frames is reused for new ones.
+class FrameRecorder {
+public:
+    explicit FrameRecorder(const RecordingOptions& options);
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // Writes all queued frames, then stops the writer thread
+    ~FrameRecorder();
+
+    // Returns a buffer of size bytes for the next frame
+    std::vector<uint8_t> takeBuffer(size_t size);
+
+    // Queues frame number frame given as 8-bit RGBA values, row by row from the top.
+    // Returns false if the frame was dropped.
+    bool submit(std::vector<uint8_t> rgba, int width, int height, size_t frame);
+
+    // Counts a frame that was dropped before it reached the recorder
+    void drop();
+
+    RecordingStats stats() const;
+    const RecordingOptions& options() const;
+
+private:
+    struct Frame {
+        std::vector<uint8_t> rgba;
+        int width;
+        int height;
+        size_t number;
+    };
+
+    void run();
+    void write(const Frame& frame) const;
+
+    RecordingOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable spaceAvailable_;
+    std::deque<Frame> queue_;
+    std::vector<std::vector<uint8_t>> freeBuffers_;
+    RecordingStats stats_;
+    bool stopping_;
+
+    std::thread writer_;
+};
+
+// Encoders used by the recorder, rgba holds width * height 8-bit RGBA values, top row first
+void writePpm(const std::string& path, int width, int height, std::span<const uint8_t> rgba);
+void writePng(const std::string& path, int width, int height, std::span<const uint8_t> rgba);
+
+}  // namespace rendering
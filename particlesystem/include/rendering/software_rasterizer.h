@@ -0,0 +1,78 @@
+#pragma once
+
+#include <rendering/window.h>
+#include <particlesystem/worker_pool.h>
+#include <glm/vec4.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rendering {
+
+/**
+ * Multithreaded CPU renderer for points, following the semantics of Window::drawPoints:
+ * round points with a diameter of scale pixels (at least one pixel) and alpha blending
+ * with (src alpha, 1 - src alpha), drawn in submission order.
+ *
+ * Points are binned into square screen tiles, then tiles are rasterized in parallel. Each
+ * tile stores its channels as separate float planes, so the coverage test and the blend of
+ * a row of pixels are plain loops over arrays that the compiler vectorizes.
+ */
+class SoftwareRasterizer {
+public:
+    static constexpr int tileSize = 64;
+
+    // Fewer points than this per thread are binned on fewer threads
+    static constexpr size_t minPointsPerThread = 4096;
+
+    SoftwareRasterizer(int width, int height);
+
+    // Resizes the image, the contents become undefined until the next clear
+    void resize(int width, int height);
+    int width() const;
+    int height() const;
+
+    // Number of threads used for binning and rasterization, defaults to the hardware threads.
+    // The threads are kept between draws.
+    void setThreadCount(size_t count);
+    size_t threadCount() const;
+
+    // Bytes allocated for the image and the tile bins
+    size_t memoryBytes() const;
+
+    // Fills the whole image with a color, each channel is in range [0,1]
+    void clear(glm::vec4 color);
+
+    // Draws points on top of the image, positions are in normalized device coordinates
+    void drawPoints(std::span<const PointVertex> points);
+
+    // Blends an 8-bit RGBA image of the same size on top, row by row from the top
+    void drawImage(std::span<const uint8_t> rgba);
+
+    // Writes the image as 8-bit RGBA values, row by row from the top.
+    // rgba must hold width() * height() * 4 values.
+    void readPixels(std::span<uint8_t> rgba) const;
+    std::vector<uint8_t> readPixels() const;
+
+private:
+    struct Tile {
+        int x0, y0, x1, y1;  // Pixel bounds, x1 and y1 exclusive
+        std::vector<float> r, g, b, a;
+    };
+
+    void rasterize(Tile& tile, std::span<const PointVertex> points,
+                   std::span<const uint32_t> indices) const;
+
+    int width_;
+    int height_;
+    int tilesX_;
+    int tilesY_;
+    particlesystem::WorkerPool workers_;
+    std::vector<Tile> tiles_;
+
+    // Per thread lists of point indices for each tile, reused between draws
+    std::vector<std::vector<std::vector<uint32_t>>> bins_;
+};
+
+}  // namespace rendering
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <rendering/frame_recorder.h>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <string_view>
 #include <span>
 #include <vector>
@@ -11,9 +16,90 @@
 /// of general ui elements and graphics primitives.
 namespace rendering {
 
+// Layout of a single point in the vertex buffer
+struct PointVertex {
+    glm::vec2 position;
+    float scale;
+    uint32_t color;  // RGBA, 8 bits per channel with red in the lowest byte
+};
+static_assert(sizeof(PointVertex) == 16, "PointVertex must match the vertex buffer layout");
+
+// Converts a color channel in range [0,1] to 8 bits, values outside the range are clamped
+inline uint8_t toByte(float c) {
+    c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+    return static_cast<uint8_t>(c * 255.0f + 0.5f);
+}
+
+// Packs a color with channels in range [0,1] the way the vertex buffer expects it
+inline uint32_t packColor(glm::vec4 color) {
+    const auto channel = [](float c) { return static_cast<uint32_t>(toByte(c)); };
+    return channel(color.r) | (channel(color.g) << 8) | (channel(color.b) << 16) |
+           (channel(color.a) << 24);
+}
+
+// Writes points into vertex memory, out[i] is made from pos[i], radius[i] and color[i].
+// Writes min(out.size(), pos.size(), radius.size(), color.size()) points.
+void packPoints(std::span<PointVertex> out, std::span<const glm::vec2> pos,
+                std::span<const float> radius, std::span<const glm::vec4> color);
+
+// Returns chunk index out of chunkCount nearly equal, disjoint and contiguous chunks of points
+std::span<PointVertex> pointChunk(std::span<PointVertex> points, size_t index, size_t chunkCount);
+
+// 2D camera for panning and zooming. Everything drawn is given in world coordinates and
+// appears on screen at (position - center) * zoom in normalized device coordinates, with
+// point sizes scaled by zoom. The default camera shows the box [-1,1] as before.
+struct Camera2D {
+    glm::vec2 center = glm::vec2(0.0f, 0.0f);
+    float zoom = 1.0f;
+
+    glm::vec2 toScreen(glm::vec2 world) const { return (world - center) * zoom; }
+    glm::vec2 toWorld(glm::vec2 screen) const { return screen / zoom + center; }
+
+    // Corners of the visible area in world coordinates, grown by margin on every side
+    glm::vec2 visibleMin(float margin = 0.0f) const {
+        return center - glm::vec2(1.0f / zoom + margin, 1.0f / zoom + margin);
+    }
+    glm::vec2 visibleMax(float margin = 0.0f) const {
+        return center + glm::vec2(1.0f / zoom + margin, 1.0f / zoom + margin);
+    }
+};
+
+// Options for creating a window
+struct WindowOptions {
+    // Render offscreen without showing a window. Where GLFW supports it (3.4 and newer) this
+    // needs no display server at all and uses an EGL or OSMesa context, so it also works
+    // with Mesa's software renderer on machines without a GPU.
+    bool headless = false;
+
+    // If not empty, every finished frame is written to <frameDumpPrefix><frame number>.ppm
+    // by a background writer, see startRecording
+    std::string frameDumpPrefix;
+
+    // Draw points on the CPU with a SoftwareRasterizer and show the result as an image.
+    // Faster than a software OpenGL implementation on machines without a GPU.
+    bool softwareRasterizer = false;
+
+    // Stream points through a persistently mapped buffer ring where the driver supports it.
+    // When false, or if PARTICLESYSTEM_NO_PERSISTENT_MAP is set, the buffer is orphaned and
+    // mapped once per batch instead.
+    bool persistentMapping = true;
+};
+
+// Memory held by a window for drawing and recording, in bytes. GPU buffers count the size
+// requested from the driver.
+struct WindowMemory {
+    size_t vertexBuffer = 0;  // Point vertex buffer on the GPU
+    size_t readback = 0;      // Pixel buffers recorded frames are read back through, on the GPU
+    size_t software = 0;      // Software rasterizer with its point queue and image
+    size_t density = 0;       // Density grid and its image
+    size_t recorder = 0;      // Frames queued or kept for reuse by the frame recorder
+    size_t total = 0;         // Sum of the above
+    size_t peak = 0;          // Largest total at the end of any frame
+};
+
 class Window {
 public:
-    Window(std::string_view title, int width, int height);
+    Window(std::string_view title, int width, int height, const WindowOptions& options = {});
     Window(const Window&) = delete;
     Window(Window&&) = delete;
     Window& operator=(const Window&) = delete;
@@ -54,10 +140,20 @@ public:
     // Finalizes the current frame and swaps the front and back buffers for double buffering.
     void endFrame();
 
+    // Returns true if the window renders offscreen
+    bool headless() const;
+
+    // Reads back the current frame as 8-bit RGBA values, row by row from the top.
+    // Queued points are drawn first. The user interface is only part of the frame once
+    // endFrame has rendered it, so this is best called before.
+    std::vector<uint8_t> readPixels();
+
     // Clear the window with specific color, each channel is in range [0,1]
     void clear(glm::vec4 color);
 
     // Draws points on screen
+    // Points are queued and drawn together, in the order they were submitted, when the frame
+    // ends or the window is cleared, so many small calls cost no more than one large one.
     void drawPoint(glm::vec2 pos, float radius, glm::vec4 color);
     void drawPoints(std::span<const glm::vec2> pos, std::span<const float> radius,
                     std::span<const glm::vec4> color);
@@ -71,6 +167,56 @@ public:
     void drawPoints(const glm::vec2* pos, const float* radius, const glm::vec4* color, size_t count,
                     size_t stride_in_bytes = 0);
 
+    // Called with a chunk of vertex memory and the index of its first point
+    using PointWriter = std::function<void(std::span<PointVertex> chunk, size_t first)>;
+
+    // Draws count points that are written straight into the vertex buffer by \p write.
+    // The buffer is split into chunkCount chunks which are written in parallel, so \p write
+    // must be safe to call concurrently for different chunks. The window keeps a pool of up
+    // to one thread per hardware thread that grows with the largest chunkCount seen and never
+    // shrinks, so varying chunk counts do not start or stop threads. Chunks hold at least a
+    // few thousand points, so small draws and the short ends of streamed draws are split less.
+    void drawPoints(size_t count, const PointWriter& write, size_t chunkCount = 1);
+
+    // Low level access to the vertex buffer: beginPoints returns memory for count points that
+    // the caller fills in any way it likes, endPoints queues them for drawing.
+    // No other drawing may happen in between. Unlike drawPoints, which streams any number
+    // of points, a single batch holds at most maxBatchSize() points.
+    std::span<PointVertex> beginPoints(size_t count);
+    void endPoints();
+    static size_t maxBatchSize();
+
+    // Draws all queued points now. This happens automatically in clear() and endFrame().
+    void flush();
+
+    // Records every finished frame, including the user interface, to image files. Frames
+    // are read back asynchronously and written by a background thread, so the render loop
+    // does not wait for the GPU or the disk. With the software rasterizer the recorded image
+    // is the rasterizer output without the user interface.
+    void startRecording(const RecordingOptions& options);
+    void stopRecording();
+    bool isRecording() const;
+    RecordingStats recordingStats() const;
+
+    // Camera used for all following drawing, points queued before keep the previous camera
+    void setCamera(const Camera2D& camera);
+    const Camera2D& camera() const;
+
+    // Draws particles as a density image instead of as points: every pixel shows the mean
+    // color of the particles in it, more opaque the more particles there are (see
+    // DensityGrid::toneMap). After binning, the cost depends on the window size and not on
+    // the number of particles, which suits very large systems.
+    void drawDensity(std::span<const glm::vec2> pos, std::span<const glm::vec4> color,
+                     float exposure = 0.25f);
+
+    // Returns true if points are streamed through a persistently mapped buffer ring, false
+    // if the buffer is orphaned and mapped once per batch of queued points, see
+    // WindowOptions::persistentMapping.
+    bool usesPersistentMapping() const;
+
+    // Memory currently held for drawing and recording, see WindowMemory
+    WindowMemory memoryStats() const;
+
     // UI
     void beginGuiWindow(std::string_view label);
     void endGuiWindow();
@@ -0,0 +1,149 @@
+#include "batch.h"
+#include "options.h"
+
+#include <example/particle_demo.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace {
+
+constexpr std::string_view usage =
+    "Usage: application [--headless [--frames N] [--dt S] [--scene FILE] [--particles M]\n"
+    "                   [--seed S] [--threads T]]\n";
+
+}  // namespace
+
+std::optional<BatchOptions> parseBatchOptions(int argc, char** argv) {
+    BatchOptions options;
+    bool headless = false;
+    bool batchFlags = false;
+    bool help = false;
+    try {
+        forEachOption(
+            argc, argv,
+            [&](std::string_view flag, std::string_view value) {
+                if (flag == "--headless") {
+                    headless = true;
+                    return;
+                }
+                if (flag == "--help") {
+                    help = true;
+                    return;
+                }
+                if (flag == "--frames") {
+                    options.frames = parseNumber<size_t>(flag, value);
+                } else if (flag == "--dt") {
+                    options.dt = parseNumber<float>(flag, value);
+                } else if (flag == "--scene") {
+                    options.scene = value;
+                } else if (flag == "--particles") {
+                    options.particles = parseNumber<size_t>(flag, value);
+                } else if (flag == "--seed") {
+                    options.seed = parseNumber<uint64_t>(flag, value);
+                } else if (flag == "--threads") {
+                    options.threads = parseNumber<size_t>(flag, value);
+                } else {
+                    throw std::runtime_error(fmt::format("Unknown flag {}", flag));
+                }
+                batchFlags = true;
+            },
+            {"--headless", "--help"});
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(fmt::format("{}\n{}", e.what(), usage));
+    }
+    if (help) {
+        throw std::runtime_error(std::string(usage));
+    }
+
+    if (!headless) {
+        if (batchFlags) {
+            throw std::runtime_error(fmt::format("Batch options require --headless\n{}", usage));
+        }
+        return std::nullopt;
+    }
+    return options;
+}
+
+void runBatch(const BatchOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    example::ParticleDemo demo;
+    if (!options.scene.empty()) {
+        demo.loadScene(options.scene);
+    }
+    demo.setSeed(options.seed);
+    demo.setSnapshotParticles(false);
+    demo.setThreadCount(options.threads);
+    // The scene emitters get the usual particle limit on top of the initial particles
+    demo.setMaxParticles(options.particles + ps::ParticleSystem::defaultMaxParticles);
+    // The initial particles live through the whole run, so they are a constant load
+    const float duration = static_cast<float>(options.frames) * options.dt;
+    demo.addParticles(options.particles, duration + 1.0f, options.seed);
+
+    const ps::ParticleSystem& system = demo.getSystem();
+    std::vector<double> frameSeconds;
+    frameSeconds.reserve(options.frames);
+    std::array<double, ps::UpdateStats::PhaseCount> phaseSeconds{};
+    size_t particleUpdates = 0;
+
+    double time = 0.0;
+    for (size_t frame = 0; frame < options.frames; ++frame) {
+        const auto start = Clock::now();
+        demo.update(time, options.dt, glm::vec2(0.0f, 0.0f));
+        frameSeconds.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+
+        time += options.dt;
+        particleUpdates += system.getAliveCount();
+        for (size_t phase = 0; phase < ps::UpdateStats::PhaseCount; ++phase) {
+            phaseSeconds[phase] += system.stats().phaseSeconds[phase];
+        }
+    }
+
+    double total = 0.0;
+    for (double seconds : frameSeconds) {
+        total += seconds;
+    }
+    std::vector<double> sorted = frameSeconds;
+    std::sort(sorted.begin(), sorted.end());
+    const auto percentile = [&sorted](double p) {
+        return sorted.empty() ? 0.0 : sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))];
+    };
+    const double frames = static_cast<double>(std::max<size_t>(options.frames, 1));
+
+    fmt::print("Headless run: {} frames of {:.4f} s, seed {:#x}, {} threads, scene {}\n",
+               options.frames, options.dt, options.seed, system.getThreadCount(),
+               options.scene.empty() ? "none" : options.scene);
+    fmt::print("Particles: {} alive at the end, {:.0f} on average\n", system.getAliveCount(),
+               static_cast<double>(particleUpdates) / frames);
+    fmt::print("Update: {:.3f} s total, {:.3f} ms/frame (median {:.3f}, p95 {:.3f}, max {:.3f})\n",
+               total, total / frames * 1000.0, percentile(0.5) * 1000.0,
+               percentile(0.95) * 1000.0, percentile(1.0) * 1000.0);
+    if (particleUpdates > 0) {
+        fmt::print("Throughput: {:.2f} M particle updates/s, {:.2f} ns/particle/frame\n",
+                   static_cast<double>(particleUpdates) / total / 1e6,
+                   total * 1e9 / static_cast<double>(particleUpdates));
+    }
+
+    if constexpr (ps::UpdateStats::enabled) {
+        fmt::print("Phases (ms/frame):\n");
+        for (size_t phase = 0; phase < ps::UpdateStats::PhaseCount; ++phase) {
+            fmt::print("  {:<14} {:8.3f}\n", ps::UpdateStats::phaseNames[phase],
+                       phaseSeconds[phase] / frames * 1000.0);
+        }
+    } else {
+        fmt::print("Phases: build with PARTICLESYSTEM_STATS=ON for per-phase timings\n");
+    }
+
+    const ps::MemoryStats& memory = system.memoryStats();
+    fmt::print("Memory: {:.2f} MB, peak {:.2f} MB\n",
+               static_cast<double>(memory.bytes) / (1024.0 * 1024.0),
+               static_cast<double>(memory.peakBytes) / (1024.0 * 1024.0));
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Options of a headless batch run, see runBatch
+struct BatchOptions {
+    size_t frames = 600;        // Number of updates
+    float dt = 1.0f / 60.0f;    // Fixed time step of every update
+    std::string scene;          // Scene file, see ParticleDemo::loadScene, empty for none
+    size_t particles = 100000;  // Particles spawned before the first update
+    uint64_t seed = 0x5EED5EED2024ull;
+    size_t threads = 1;         // See ParticleSystem::setThreadCount
+};
+
+// Parses the command line. Returns no options if the application should run interactively.
+// Throws std::runtime_error for unknown flags or missing values.
+std::optional<BatchOptions> parseBatchOptions(int argc, char** argv);
+
+// Runs the demo for a fixed number of frames without a window or rendering and prints the
+// throughput, per-phase timings and memory use
+void runBatch(const BatchOptions& options);
@@ -1,6 +1,10 @@
 #include <rendering/window.h>
 #include <example/randomsystem.h>
 #include <example/particle_demo.h>
+#include <example/simulation_thread.h>
+#include <particlesystem/trace.h>
+
+#include "batch.h"
 
 #include <fmt/format.h>
 #include <imgui.h>
@@ -9,16 +13,27 @@
 #include <vector>
 #include <random>
 #include <algorithm>
+#include <thread>
+#include <optional>
 
 /*
  * This application represents the "Client" the uses your particle system
  */
-int main() try {
+int main(int argc, char** argv) try {
+    // Run a fixed number of frames without a window when asked to, e.g. for load tests
+    if (const std::optional<BatchOptions> batch = parseBatchOptions(argc, argv)) {
+        runBatch(*batch);
+        return EXIT_SUCCESS;
+    }
+
     rendering::Window window("Particle System v0.0.2 pre-release beta", 850, 850);
 
     // Create our new particle demo system
     example::ParticleDemo particleDemo;
 
+    // Worker thread that simulates the next frame while the current one is rendered
+    example::SimulationThread simulation{particleDemo};
+
     // Keep the old system for comparison
     const size_t numParticles = 1000;
     std::cout << "[UPDATE] " << __FUNCTION__ << " at line " << __LINE__ << std::endl; // Task 6 test print
@@ -27,14 +42,33 @@ int main() try {
     float speed = 1.0f;
     bool running = true;
     bool useNewSystem = true;    // Toggle between old and new system
+    bool pipelined = true;       // Simulate frame N+1 while rendering frame N
+    bool densityView = false;    // Draw particles as a density image instead of as points
+    float exposure = 0.25f;      // Brightness of the density image
+    int renderBudget = 0;        // Most particles drawn per frame, 0 for no limit
+    rendering::Camera2D camera;  // Pan and zoom of the view
+    int traceFrames = 120;       // Length of a captured timeline trace
     bool prevMouseDown = false;  // Track previous mouse state
 
     // Mouse click handling variables
     bool mouseButtonClicked = false;
 
+    // Threads packing points into the vertex buffer, small batches are packed by one thread
+    const size_t packThreads = std::max(1u, std::thread::hardware_concurrency());
+    const auto packChunks = [packThreads](size_t count) {
+        constexpr size_t pointsPerChunk = 16 * 1024;
+        return std::min(packThreads, count / pointsPerChunk + 1);
+    };
+
+    particlesystem::trace::setThreadName("Main");
+
     while (running) {
         window.beginFrame();
 
+        // Wait for the simulation step started last frame, after this the demo can safely be
+        // modified by the user interface
+        simulation.wait();
+
         // Get mouse position and convert to normalized coordinates (-1 to 1)
         auto mousePos = window.mousePosition();
         glm::vec2 normalizedMousePos =
@@ -42,6 +76,8 @@ int main() try {
                       -((mousePos.y / window.height()) * 2.0f -
                         1.0f)  // Flip Y since window coordinates are top-down
             );
+        // The simulation works in world coordinates, which the camera may pan and zoom
+        normalizedMousePos = camera.toWorld(normalizedMousePos);
 
         // Manual mouse click detection using ImGui
         bool mouseDown = ImGui::GetIO().MouseDown[0];  // 0 = left mouse button
@@ -52,32 +88,7 @@ int main() try {
         }
         prevMouseDown = mouseDown;
 
-        if (useNewSystem) {
-            // Update our new particle demo
-            particleDemo.update(window.time(), window.deltaTime() * speed, normalizedMousePos);
-        } else {
-            // Update the example system
-            randomSystem.update(window.time(), speed);
-        }
-
-        // Clear screen with color
-        window.clear({0.05f, 0.05f, 0.1f, 1.0f});
-
-        // Draw particles
-        if (useNewSystem) {
-            // Draw the particles
-            window.drawPoints(particleDemo.getPositions(), particleDemo.getSizes(),
-                              particleDemo.getColors());
-
-            // Draw markers for emitters and effects
-            window.drawPoints(particleDemo.getMarkerPositions(), particleDemo.getMarkerSizes(),
-                              particleDemo.getMarkerColors());
-        } else {
-            window.drawPoints(randomSystem.getPosition(), randomSystem.getSize(),
-                              randomSystem.getColor());
-        }
-
-        // User interface
+        // User interface, this is only recorded here and rendered in endFrame
         {
             window.beginGuiWindow("Particle System Controls");
 
@@ -90,6 +101,18 @@ int main() try {
 
             window.text("Simulation Controls");
             window.sliderFloat("Simulation Speed", speed, 0.001f, 10.0f);
+            window.sliderFloat("Camera Zoom", camera.zoom, 0.25f, 16.0f);
+            window.sliderVec2("Camera Center", camera.center, -2.0f, 2.0f);
+            if (useNewSystem) {
+                window.checkbox("Pipelined Simulation", pipelined);
+                if (window.sliderInt("Render Budget", renderBudget, 0, 1000000)) {
+                    particleDemo.setRenderBudget(static_cast<size_t>(renderBudget));
+                }
+                window.checkbox("Density View", densityView);
+                if (densityView) {
+                    window.sliderFloat("Exposure", exposure, 0.01f, 2.0f);
+                }
+            }
 
             if (window.button(useNewSystem ? "Switch to Original System"
                                            : "Switch to New Particle System")) {
@@ -98,8 +121,40 @@ int main() try {
 
             window.separator();
             window.text(fmt::format("FPS: {:.1f}", window.fps()));
+            window.text(fmt::format("Vertex upload: {}", window.usesPersistentMapping()
+                                                             ? "persistent ring"
+                                                             : "orphaned buffer"));
             window.text(
                 fmt::format("Mouse: ({:.2f}, {:.2f})", normalizedMousePos.x, normalizedMousePos.y));
+            const rendering::WindowMemory memory = window.memoryStats();
+            window.text(fmt::format("Window memory: {:.2f} MB (peak {:.2f} MB)",
+                                    static_cast<double>(memory.total) / (1024.0 * 1024.0),
+                                    static_cast<double>(memory.peak) / (1024.0 * 1024.0)));
+
+            // Frames are written on a background thread, a full queue drops frames instead
+            // of slowing down the render loop
+            bool recording = window.isRecording();
+            if (window.checkbox("Record Frames", recording)) {
+                if (recording) {
+                    window.startRecording({.prefix = "frame_", .format = rendering::FrameFormat::Png});
+                } else {
+                    window.stopRecording();
+                }
+            }
+            if (window.isRecording()) {
+                const rendering::RecordingStats stats = window.recordingStats();
+                window.text(fmt::format("Recorded: {} written, {} dropped, queue {} (max {})",
+                                        stats.written, stats.dropped, stats.queueDepth,
+                                        stats.maxQueueDepth));
+            }
+
+            // Timeline of the next frames, open the file in chrome://tracing or ui.perfetto.dev
+            window.sliderInt("Trace Frames", traceFrames, 1, 600);
+            if (particlesystem::trace::active()) {
+                window.text("Capturing trace...");
+            } else if (window.button("Capture Trace")) {
+                particlesystem::trace::start("trace.json", static_cast<size_t>(traceFrames));
+            }
 
             if (window.button("Close Application")) {
                 running = false;
@@ -107,6 +162,73 @@ int main() try {
             window.endGuiWindow();
         }
 
+        window.setCamera(camera);
+
+        if (useNewSystem) {
+            // Only a pipelined simulation needs its own copy of the particles per frame
+            particleDemo.setSnapshotParticles(pipelined);
+            // Particles the camera cannot see are not exported, the margin covers their size
+            particleDemo.setCullRect(camera.visibleMin(0.05f / camera.zoom),
+                                     camera.visibleMax(0.05f / camera.zoom));
+            if (pipelined) {
+                // Simulate the next frame in the background, we draw the previous one below
+                simulation.kick(window.time(), window.deltaTime() * speed, normalizedMousePos);
+            } else {
+                // Update our new particle demo
+                particleDemo.update(window.time(), window.deltaTime() * speed, normalizedMousePos);
+            }
+        } else {
+            // Update the example system
+            randomSystem.update(window.time(), speed);
+        }
+
+        // Clear screen with color
+        window.clear({0.05f, 0.05f, 0.1f, 1.0f});
+
+        // Draw particles
+        if (useNewSystem) {
+            // Latest completed frame, never blocks on the simulation
+            const example::RenderFrame& frame = particleDemo.acquireFrame();
+
+            // Draw the particles, straight from the simulation when it is not running ahead
+            if (densityView) {
+                const ps::ParticleSystem& system = particleDemo.getSystem();
+                window.drawDensity(pipelined ? std::span<const glm::vec2>(frame.positions)
+                                             : system.getPositions(),
+                                   pipelined ? std::span<const glm::vec4>(frame.colors)
+                                             : system.getColors(),
+                                   exposure);
+            } else if (pipelined) {
+                window.drawPoints(frame.positions, frame.sizes, frame.colors);
+            } else {
+                // Pack the columns of the system directly into the vertex buffer
+                const ps::ParticleSystem& system = particleDemo.getSystem();
+                window.drawPoints(
+                    system.getRenderCount(),
+                    [&system](std::span<rendering::PointVertex> chunk, size_t first) {
+                        rendering::packPoints(chunk,
+                                              system.getPositions().subspan(first, chunk.size()),
+                                              system.getSizes().subspan(first, chunk.size()),
+                                              system.getColors().subspan(first, chunk.size()));
+                    },
+                    packChunks(system.getRenderCount()));
+            }
+
+            // Draw markers for emitters and effects
+            window.drawPoints(frame.markerPositions, frame.markerSizes, frame.markerColors);
+        } else {
+            const size_t count = randomSystem.getPosition().size();
+            window.drawPoints(
+                count,
+                [&randomSystem](std::span<rendering::PointVertex> chunk, size_t first) {
+                    rendering::packPoints(
+                        chunk, std::span(randomSystem.getPosition()).subspan(first, chunk.size()),
+                        std::span(randomSystem.getSize()).subspan(first, chunk.size()),
+                        std::span(randomSystem.getColor()).subspan(first, chunk.size()));
+                },
+                packChunks(count));
+        }
+
         window.endFrame();
         running = running && !window.shouldClose();
     }
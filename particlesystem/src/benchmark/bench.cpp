@@ -0,0 +1,316 @@
+#include <particlesystem/all.h>
+#include <rendering/window.h>
+#include "common.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Benchmarks of the hot paths of the particle system: ParticleSystem::update in several
+ * configurations, every emitter's emit, every effect's apply, getParticleData and the
+ * point packing loop behind Window::drawPoints. Every benchmark runs for 1k up to 10M
+ * particles and the results are written as JSON, to stdout or to the file given by --out.
+ *
+ * Options:
+ *   --max <count>       Largest particle count, default 10000000
+ *   --min-time <s>      Least time measured per benchmark and count, default 0.2
+ *   --filter <text>     Only run benchmarks whose name contains text
+ *   --out <file>        Write the JSON to a file instead of stdout
+ */
+
+namespace {
+
+struct Result {
+    std::string name;
+    size_t particles;
+    size_t iterations;
+    double medianNs;
+    double minNs;
+};
+
+class Harness {
+public:
+    Harness(double minTime, std::string filter) : minTime_{minTime}, filter_{std::move(filter)} {}
+
+    bool enabled(std::string_view name) const {
+        return name.find(filter_) != std::string_view::npos;
+    }
+
+    // Times run() until minTime has passed, with at least three samples. setup() runs before
+    // every sample and is not timed.
+    void measure(std::string_view name, size_t particles, const std::function<void()>& setup,
+                 const std::function<void()>& run) {
+        if (!enabled(name)) {
+            return;
+        }
+
+        using Clock = std::chrono::steady_clock;
+        std::vector<double> samples;
+        double total = 0.0;
+        while ((samples.size() < 3 || total < minTime_) && samples.size() < 1000) {
+            setup();
+            const auto start = Clock::now();
+            run();
+            const auto end = Clock::now();
+            const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            samples.push_back(ns);
+            total += ns * 1e-9;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        const Result result{std::string(name), particles, samples.size(),
+                            samples[samples.size() / 2], samples.front()};
+        fmt::print(stderr, "{:<24} {:>9} particles  {:12.0f} ns  {:7.2f} ns/particle\n",
+                   result.name, particles, result.medianNs,
+                   result.medianNs / static_cast<double>(particles));
+        results_.push_back(result);
+    }
+
+    void measure(std::string_view name, size_t particles, const std::function<void()>& run) {
+        measure(name, particles, []() {}, run);
+    }
+
+    std::string json(size_t maxParticles) const {
+        std::string out = "{\n  \"context\": {\n";
+#ifdef NDEBUG
+        out += "    \"build\": \"release\",\n";
+#else
+        out += "    \"build\": \"debug\",\n";
+#endif
+        out += fmt::format("    \"sanitizer\": \"{}\",\n", sanitizer());
+        out += fmt::format("    \"threads\": {},\n", std::thread::hardware_concurrency());
+        out += fmt::format("    \"max_particles\": {},\n", maxParticles);
+        out += fmt::format("    \"min_time_s\": {}\n", minTime_);
+        out += "  },\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const Result& r = results_[i];
+            out += fmt::format(
+                "    {{\"name\": \"{}\", \"particles\": {}, \"iterations\": {}, "
+                "\"median_ns\": {:.0f}, \"min_ns\": {:.0f}, \"ns_per_particle\": {:.4f}}}{}\n",
+                r.name, r.particles, r.iterations, r.medianNs, r.minNs,
+                r.medianNs / static_cast<double>(r.particles), i + 1 < results_.size() ? "," : "");
+        }
+        out += "  ]\n}\n";
+        return out;
+    }
+
+private:
+    double minTime_;
+    std::string filter_;
+    std::vector<Result> results_;
+};
+
+constexpr float dt = 1.0f / 60.0f;
+
+// Emitters create at most this many particles per call
+constexpr size_t spawnStep = ps::Emitter::maxSpawnCount;
+
+// Emits at least count particles into out, in steps of at most maxSpawnCount particles
+void emitCount(ps::Emitter& emitter, std::vector<ps::Particle>& out, size_t count) {
+    constexpr float rate = 1e6f;
+    emitter.setRate(rate);
+    while (out.size() < count) {
+        const size_t step = std::min(count - out.size(), spawnStep);
+        emitter.emit(out, static_cast<float>(step) / rate);
+    }
+}
+
+void benchUpdate(Harness& h, size_t count, const std::vector<ps::Particle>& particles) {
+    std::unique_ptr<ps::ParticleSystem> system;
+
+    const auto run = [&](std::string_view name, const std::function<void()>& configure) {
+        if (!h.enabled(name)) {
+            return;
+        }
+        system = std::make_unique<ps::ParticleSystem>();
+        configure();
+        system->setParticles(particles);
+        h.measure(name, count, [&]() { system->update(dt); });
+    };
+
+    // Integration, compaction and render columns only
+    run("update/integrate", []() {});
+    run("update/bounds", [&]() { system->setBounds({-1.0f, -1.0f}, {1.0f, 1.0f}, 0.9f); });
+    run("update/effects", [&]() {
+        system->addEffect(std::make_shared<ps::GravityWell>(glm::vec2(0.0f, 0.0f)));
+        auto wind = std::make_shared<ps::Wind>(glm::vec2(1.0f, 0.0f));
+        wind->setVarying(true);
+        system->addEffect(wind);
+    });
+    run("update/cull+budget", [&]() {
+        system->setCullRect({-1.0f, -1.0f}, {0.0f, 1.0f});
+        system->setRenderBudget(std::max<size_t>(count / 10, 1));
+    });
+
+    // Emission and merging of count new particles that die within the same step
+    if (h.enabled("update/emit")) {
+        system = std::make_unique<ps::ParticleSystem>();
+        system->setMaxParticles(count);
+        const size_t emitters = (count + spawnStep - 1) / spawnStep;
+        for (size_t i = 0; i < emitters; ++i) {
+            auto emitter = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+            emitter->setRate(static_cast<float>(count / emitters) / dt);
+            emitter->setLifetimeRange(dt * 0.25f, dt * 0.5f);
+            emitter->setStream(static_cast<uint32_t>(i));
+            system->addEmitter(emitter);
+        }
+        h.measure("update/emit", count, [&]() { system->update(dt); });
+    }
+}
+
+void benchEmitters(Harness& h, size_t count) {
+    std::vector<ps::Particle> out;
+    out.reserve(count + spawnStep);
+    const auto run = [&](std::string_view name, ps::Emitter& emitter) {
+        h.measure(name, count, [&]() { out.clear(); }, [&]() { emitCount(emitter, out, count); });
+    };
+
+    const glm::vec2 origin(0.0f, 0.0f);
+    ps::UniformEmitter uniform{origin};
+    run("emit/uniform", uniform);
+    ps::UniformEmitter lowDiscrepancy{origin};
+    lowDiscrepancy.setSamplingMode(ps::SamplingMode::LowDiscrepancy);
+    run("emit/uniform-ld", lowDiscrepancy);
+    ps::DirectionalEmitter directional{origin, {0.0f, 1.0f}};
+    run("emit/directional", directional);
+    ps::LineEmitter line{origin, {{-0.5f, 0.0f}, {0.0f, 0.5f}, {0.5f, 0.0f}}};
+    run("emit/line", line);
+    ps::RingEmitter ring{origin, 0.5f, 0.1f};
+    run("emit/ring", ring);
+    ps::PolygonEmitter polygon{
+        origin, {{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.0f, 0.0f}, {0.5f, 0.5f}, {-0.5f, 0.5f}}};
+    run("emit/polygon", polygon);
+    std::vector<float> mask(64 * 64);
+    for (size_t i = 0; i < mask.size(); ++i) {
+        mask[i] = static_cast<float>((i * 7) % 5) * 0.25f;
+    }
+    ps::MaskEmitter maskEmitter{origin, 64, 64, mask, 1.0f / 64.0f};
+    run("emit/mask", maskEmitter);
+
+    // Explosions emit their whole burst at once
+    ps::ExplosionEmitter explosion{origin};
+    explosion.setParticleCount(static_cast<int>(count));
+    h.measure(
+        "emit/explosion", count,
+        [&]() {
+            out.clear();
+            explosion.trigger();
+        },
+        [&]() { explosion.emit(out, dt); });
+}
+
+void benchEffects(Harness& h, size_t count, std::vector<ps::Particle>& particles) {
+    const auto run = [&](std::string_view name, ps::Effect& effect) {
+        h.measure(name, count, [&]() {
+            for (auto& particle : particles) {
+                effect.apply(particle);
+            }
+        });
+    };
+
+    ps::GravityWell well{{0.0f, 0.0f}};
+    run("apply/gravity-well", well);
+    ps::Wind wind{{1.0f, 0.0f}};
+    run("apply/wind", wind);
+    ps::Wind varyingWind{{1.0f, 0.0f}};
+    varyingWind.setVarying(true);
+    run("apply/wind-varying", varyingWind);
+}
+
+void benchExport(Harness& h, size_t count, const std::vector<ps::Particle>& particles) {
+    if (h.enabled("getParticleData")) {
+        ps::ParticleSystem system;
+        system.setParticles(particles);
+        std::vector<glm::vec2> positions;
+        std::vector<glm::vec4> colors;
+        std::vector<float> sizes;
+        h.measure("getParticleData", count,
+                  [&]() { system.getParticleData(positions, colors, sizes); });
+    }
+
+    if (!h.enabled("packPoints")) {
+        return;
+    }
+    ps::BatchRng rng{7};
+    std::vector<glm::vec2> positions(count);
+    std::vector<float> sizes(count);
+    std::vector<glm::vec4> colors(count, glm::vec4(1.0f, 0.5f, 0.25f, 0.5f));
+    rng.uniform(positions, {-1.0f, -1.0f}, {1.0f, 1.0f});
+    rng.uniform(sizes, 1.0f, 4.0f);
+    std::vector<rendering::PointVertex> vertices(count);
+
+    h.measure("packPoints", count,
+              [&]() { rendering::packPoints(vertices, positions, sizes, colors); });
+
+    // The same split into chunks as Window::drawPoints, on a pool started before timing
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    ps::WorkerPool pool(threads);
+    h.measure("packPoints/parallel", count, [&]() {
+        pool.parallelFor(threads, [&](size_t t) {
+            const std::span<rendering::PointVertex> chunk =
+                rendering::pointChunk(vertices, t, threads);
+            const size_t first = static_cast<size_t>(chunk.data() - vertices.data());
+            rendering::packPoints(chunk, std::span(positions).subspan(first),
+                                  std::span(sizes).subspan(first),
+                                  std::span(colors).subspan(first));
+        });
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+    size_t maxParticles = 10'000'000;
+    double minTime = 0.2;
+    std::string filter;
+    std::string outPath;
+    forEachOption(argc, argv, [&](std::string_view flag, std::string_view value) {
+        if (flag == "--max") {
+            maxParticles = parseNumber<size_t>(flag, value);
+        } else if (flag == "--min-time") {
+            minTime = parseNumber<double>(flag, value);
+        } else if (flag == "--filter") {
+            filter = value;
+        } else if (flag == "--out") {
+            outPath = value;
+        } else {
+            throw std::runtime_error(fmt::format("Unknown option {}", flag));
+        }
+    });
+
+    warnIfSanitized();
+    Harness harness{minTime, filter};
+    for (size_t count = 1'000; count <= maxParticles; count *= 10) {
+        std::vector<ps::Particle> particles = makeParticles(count);
+        benchUpdate(harness, count, particles);
+        benchEmitters(harness, count);
+        benchEffects(harness, count, particles);
+        benchExport(harness, count, particles);
+    }
+
+    const std::string json = harness.json(maxParticles);
+    if (outPath.empty()) {
+        fmt::print("{}", json);
+    } else {
+        std::ofstream file(outPath);
+        if (!file) {
+            throw std::runtime_error(fmt::format("Unable to write {}", outPath));
+        }
+        file << json;
+    }
+    return EXIT_SUCCESS;
+} catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,47 @@
+#include "common.h"
+
+#include <particlesystem/random.h>
+
+#include <cstdio>
+#include <string_view>
+
+#include <glm/vec2.hpp>
+
+std::vector<particlesystem::Particle> makeParticles(size_t count) {
+    particlesystem::BatchRng rng{42};
+    std::vector<glm::vec2> positions(count);
+    std::vector<glm::vec2> velocities(count);
+    rng.uniform(positions, {-1.0f, -1.0f}, {1.0f, 1.0f});
+    rng.uniform(velocities, {-0.5f, -0.5f}, {0.5f, 0.5f});
+
+    std::vector<particlesystem::Particle> particles(count);
+    for (size_t i = 0; i < count; ++i) {
+        particles[i].position = positions[i];
+        particles[i].velocity = velocities[i];
+        particles[i].lifetime = 1e6f;
+        particles[i].alive = true;
+    }
+    return particles;
+}
+
+const char* sanitizer() {
+#if defined(__SANITIZE_ADDRESS__)
+    return "address";
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+    return "address";
+#else
+    return "none";
+#endif
+#else
+    return "none";
+#endif
+}
+
+void warnIfSanitized() {
+    if (std::string_view(sanitizer()) != "none") {
+        fmt::print(stderr, "Built with the {} sanitizer, timings are not representative. "
+                           "Configure with -DPARTICLESYSTEM_SANITIZE=OFF to measure.\n",
+                   sanitizer());
+    }
+}
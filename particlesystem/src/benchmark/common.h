@@ -0,0 +1,22 @@
+#pragma once
+
+#include <particlesystem/particle.h>
+#include "options.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <fmt/format.h>
+
+// Helpers shared by the benchmark executables
+
+// Live particles spread over the screen that do not die during a benchmark. The same count
+// always gives the same particles.
+std::vector<particlesystem::Particle> makeParticles(size_t count);
+
+// Sanitizer the benchmark was built with, "address" or "none". Timings under a sanitizer
+// are much slower than those of a normal build, see the PARTICLESYSTEM_SANITIZE CMake option.
+const char* sanitizer();
+
+// Prints a warning to stderr if the benchmark was built with a sanitizer
+void warnIfSanitized();
@@ -0,0 +1,248 @@
+#include <particlesystem/all.h>
+#include <example/randomsystem.h>
+#include "common.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Scaling benchmark of ParticleSystem::update over a matrix of particle counts, emitter
+ * counts, effect counts and worker threads, next to example::RandomSystem for the same
+ * particle counts. Every configuration is warmed up and then timed in several repetitions.
+ * The result is a CSV with the mean, standard deviation, minimum and maximum of the update
+ * time in ns per particle and frame, and the sanitizer of the build, written to stdout or to
+ * the file given by --out.
+ *
+ * Options:
+ *   --max <count>           Largest particle count, default 10000000
+ *   --threads <list>        Worker threads, default 1,2,4,... up to the hardware threads
+ *   --emitters <list>       Emitter counts, default 1,16
+ *   --effects <list>        Effect counts, default 0,2,8
+ *   --warmup <frames>       Untimed frames before measuring, default 3
+ *   --frames <frames>       Frames per repetition, default 10
+ *   --repetitions <count>   Timed repetitions per configuration, default 5
+ *   --out <file>            Write the CSV to a file instead of stdout
+ */
+
+namespace {
+
+constexpr float dt = 1.0f / 60.0f;
+
+// Share of the particles replaced by the emitters every frame. Emitted particles live for
+// a few frames, so the particle count stays close to the configured one
+constexpr float emittedPerFrame = 0.01f;
+constexpr float emittedLifetime = 4.0f * dt;
+
+struct Config {
+    std::string system;
+    size_t particles;
+    size_t emitters;
+    size_t effects;
+    size_t threads;
+};
+
+struct Timing {
+    double meanNs;  // Per particle and frame
+    double stddevNs;
+    double minNs;
+    double maxNs;
+};
+
+// Warms up with frame(), then times repetitions of frames calls each. frame() returns the
+// number of particles it updated.
+Timing measure(size_t warmup, size_t frames, size_t repetitions,
+               const std::function<size_t()>& frame) {
+    using Clock = std::chrono::steady_clock;
+    for (size_t i = 0; i < warmup; ++i) {
+        frame();
+    }
+
+    std::vector<double> samples;
+    for (size_t r = 0; r < repetitions; ++r) {
+        size_t updated = 0;
+        const auto start = Clock::now();
+        for (size_t i = 0; i < frames; ++i) {
+            updated += frame();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        samples.push_back(ns / static_cast<double>(std::max<size_t>(updated, 1)));
+    }
+
+    double sum = 0.0;
+    for (double s : samples) {
+        sum += s;
+    }
+    const double mean = sum / static_cast<double>(samples.size());
+    double squares = 0.0;
+    for (double s : samples) {
+        squares += (s - mean) * (s - mean);
+    }
+    const double variance =
+        samples.size() > 1 ? squares / static_cast<double>(samples.size() - 1) : 0.0;
+    const auto [min, max] = std::minmax_element(samples.begin(), samples.end());
+    return {mean, std::sqrt(variance), *min, *max};
+}
+
+std::unique_ptr<ps::ParticleSystem> makeSystem(const Config& config,
+                                               const std::vector<ps::Particle>& particles) {
+    auto system = std::make_unique<ps::ParticleSystem>();
+    system->setThreadCount(config.threads);
+    system->setMaxParticles(std::numeric_limits<size_t>::max());
+    system->setBounds({-1.0f, -1.0f}, {1.0f, 1.0f}, 0.9f);
+    system->setParticles(particles);
+
+    // Every configured emitter is a site that emits its share of the particles. A share
+    // above Emitter::maxSpawnCount per frame would be cut, so such a site is split into
+    // several emitters at the same position. One leftover particle from the previous frame
+    // may be added to a frame, hence the margin of one
+    const size_t sites = std::max<size_t>(config.emitters, 1);
+    const auto perSite = static_cast<size_t>(
+        std::ceil(static_cast<float>(config.particles) * emittedPerFrame / static_cast<float>(sites)));
+    const size_t split = std::max<size_t>(
+        (perSite + ps::Emitter::maxSpawnCount - 2) / (ps::Emitter::maxSpawnCount - 1), 1);
+    const float rate = static_cast<float>(perSite) / dt / static_cast<float>(split);
+    for (size_t i = 0; i < config.emitters; ++i) {
+        const float x = -0.9f + 1.8f * static_cast<float>(i) /
+                                    static_cast<float>(std::max<size_t>(config.emitters - 1, 1));
+        for (size_t j = 0; j < split; ++j) {
+            auto emitter = std::make_shared<ps::UniformEmitter>(glm::vec2(x, 0.0f));
+            emitter->setRate(rate);
+            emitter->setLifetimeRange(emittedLifetime, emittedLifetime);
+            system->addEmitter(emitter);
+        }
+    }
+    for (size_t i = 0; i < config.effects; ++i) {
+        if (i % 2 == 0) {
+            const float angle = static_cast<float>(i);
+            system->addEffect(std::make_shared<ps::GravityWell>(
+                glm::vec2(0.5f * std::cos(angle), 0.5f * std::sin(angle))));
+        } else {
+            system->addEffect(std::make_shared<ps::Wind>(glm::vec2(1.0f, 0.5f)));
+        }
+    }
+    return system;
+}
+
+std::vector<size_t> parseList(std::string_view flag, std::string_view text) {
+    std::vector<size_t> values;
+    while (!text.empty()) {
+        const size_t comma = text.find(',');
+        values.push_back(parseNumber<size_t>(flag, text.substr(0, comma)));
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+    }
+    return values;
+}
+
+std::vector<size_t> defaultThreads() {
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threads;
+    for (size_t t = 1; t < hardware; t *= 2) {
+        threads.push_back(t);
+    }
+    threads.push_back(hardware);
+    return threads;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+    size_t maxParticles = 10'000'000;
+    std::vector<size_t> threadCounts = defaultThreads();
+    std::vector<size_t> emitterCounts = {1, 16};
+    std::vector<size_t> effectCounts = {0, 2, 8};
+    size_t warmup = 3;
+    size_t frames = 10;
+    size_t repetitions = 5;
+    std::string outPath;
+    forEachOption(argc, argv, [&](std::string_view flag, std::string_view value) {
+        if (flag == "--max") {
+            maxParticles = parseNumber<size_t>(flag, value);
+        } else if (flag == "--threads") {
+            threadCounts = parseList(flag, value);
+        } else if (flag == "--emitters") {
+            emitterCounts = parseList(flag, value);
+        } else if (flag == "--effects") {
+            effectCounts = parseList(flag, value);
+        } else if (flag == "--warmup") {
+            warmup = parseNumber<size_t>(flag, value);
+        } else if (flag == "--frames") {
+            frames = parseNumber<size_t>(flag, value);
+        } else if (flag == "--repetitions") {
+            repetitions = std::max<size_t>(parseNumber<size_t>(flag, value), 1);
+        } else if (flag == "--out") {
+            outPath = value;
+        } else {
+            throw std::runtime_error(fmt::format("Unknown option {}", flag));
+        }
+    });
+
+    warnIfSanitized();
+    std::string csv =
+        "system,particles,emitters,effects,threads,frames,repetitions,"
+        "ns_per_particle_frame,stddev_ns,min_ns,max_ns,sanitizer\n";
+    const auto report = [&](const Config& config, const Timing& timing) {
+        fmt::print(stderr, "{:<14} {:>9} particles {:>3} emitters {:>3} effects {:>3} threads "
+                           "{:8.3f} ns/particle/frame (+-{:.3f})\n",
+                   config.system, config.particles, config.emitters, config.effects,
+                   config.threads, timing.meanNs, timing.stddevNs);
+        csv += fmt::format("{},{},{},{},{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{}\n",
+                           config.system, config.particles, config.emitters, config.effects,
+                           config.threads, frames, repetitions, timing.meanNs, timing.stddevNs,
+                           timing.minNs, timing.maxNs, sanitizer());
+    };
+
+    for (size_t count = 1'000; count <= maxParticles; count *= 10) {
+        // The reference system has a fixed workload on a single thread
+        {
+            example::RandomSystem random{count};
+            double time = 0.0;
+            const Timing timing = measure(warmup, frames, repetitions, [&]() {
+                time += dt;
+                random.update(time, 1.0f);
+                return random.getPosition().size();
+            });
+            report({"RandomSystem", count, 0, 0, 1}, timing);
+        }
+
+        const std::vector<ps::Particle> particles = makeParticles(count);
+        for (size_t emitters : emitterCounts) {
+            for (size_t effects : effectCounts) {
+                for (size_t threads : threadCounts) {
+                    const Config config{"ParticleSystem", count, emitters, effects, threads};
+                    auto system = makeSystem(config, particles);
+                    const Timing timing = measure(warmup, frames, repetitions, [&]() {
+                        system->update(dt);
+                        return system->getAliveCount();
+                    });
+                    report(config, timing);
+                }
+            }
+        }
+    }
+
+    if (outPath.empty()) {
+        fmt::print("{}", csv);
+    } else {
+        std::ofstream file(outPath);
+        if (!file) {
+            throw std::runtime_error(fmt::format("Unable to write {}", outPath));
+        }
+        file << csv;
+    }
+    return EXIT_SUCCESS;
+} catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,89 @@
+#include <rendering/window.h>
+#include <particlesystem/random.h>
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Measures how many points per second make it through Window::drawPoints, including packing,
+ * uploading and drawing. Pass --orphan (or set PARTICLESYSTEM_NO_PERSISTENT_MAP=1) to measure
+ * the orphaning fallback, and run with LIBGL_ALWAYS_SOFTWARE=1 to measure Mesa's software
+ * renderer. Pass --headless to run without a display.
+ */
+int main(int argc, char** argv) try {
+    rendering::WindowOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--headless") {
+            options.headless = true;
+        } else if (std::string_view(argv[i]) == "--orphan") {
+            options.persistentMapping = false;
+        }
+    }
+    rendering::Window window("Upload benchmark", 512, 512, options);
+
+    constexpr size_t maxPoints = 5'000'000;
+    constexpr int frames = 20;
+
+    // Random points, the contents do not matter but should not be trivially compressible
+    particlesystem::BatchRng rng;
+    std::vector<glm::vec2> positions(maxPoints);
+    std::vector<float> sizes(maxPoints);
+    std::vector<glm::vec4> colors(maxPoints, glm::vec4(1.0f, 1.0f, 1.0f, 0.1f));
+    rng.uniform(positions, {-1.0f, -1.0f}, {1.0f, 1.0f});
+    rng.uniform(sizes, 1.0f, 2.0f);
+
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    fmt::print("Vertex upload: {}, batch size {}, {} threads\n",
+               window.usesPersistentMapping() ? "persistent ring" : "orphaned buffer",
+               rendering::Window::maxBatchSize(), threads);
+
+    // Runs frames frames of draw(count) and prints the throughput
+    const auto measure = [&](std::string_view name, size_t count, auto&& draw) {
+        // Warm up, the first frames include buffer allocation and shader compilation
+        for (int i = 0; i < 3; ++i) {
+            window.beginFrame();
+            window.clear({0.0f, 0.0f, 0.0f, 1.0f});
+            draw(count);
+            window.endFrame();
+        }
+
+        const double start = window.time();
+        for (int i = 0; i < frames; ++i) {
+            window.beginFrame();
+            window.clear({0.0f, 0.0f, 0.0f, 1.0f});
+            draw(count);
+            window.endFrame();
+        }
+        const double seconds = window.time() - start;
+        fmt::print("{:<10} {:>9} points  {:8.2f} ms/frame  {:8.1f} Mpoints/s\n", name, count,
+                   1000.0 * seconds / frames,
+                   static_cast<double>(count) * frames / seconds / 1'000'000.0);
+    };
+
+    for (size_t count : {size_t{100'000}, size_t{1'000'000}, maxPoints}) {
+        measure("arrays", count, [&](size_t n) {
+            window.drawPoints(std::span(positions).first(n), std::span(sizes).first(n),
+                              std::span(colors).first(n));
+        });
+        measure("writer", count, [&](size_t n) {
+            window.drawPoints(
+                n,
+                [&](std::span<rendering::PointVertex> chunk, size_t first) {
+                    rendering::packPoints(chunk, std::span(positions).subspan(first),
+                                          std::span(sizes).subspan(first),
+                                          std::span(colors).subspan(first));
+                },
+                threads);
+        });
+    }
+
+    return EXIT_SUCCESS;
+} catch (const std::exception& e) {
+    fmt::print("{}", e.what());
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,19 @@
+#include "options.h"
+
+#include <algorithm>
+
+void forEachOption(int argc, char** argv,
+                   const std::function<void(std::string_view flag, std::string_view value)>& handle,
+                   std::initializer_list<std::string_view> switches) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view flag = argv[i];
+        if (std::find(switches.begin(), switches.end(), flag) != switches.end()) {
+            handle(flag, {});
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::runtime_error(fmt::format("Missing value for {}", flag));
+        }
+        handle(flag, argv[++i]);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+// Command line helpers shared by the application and the benchmark executables
+
+// Calls handle(flag, value) for every flag and its value on the command line. The flags in
+// switches take no value and are handled with an empty one.
+// Throws std::runtime_error for a flag without a value, handle throws for unknown flags.
+void forEachOption(int argc, char** argv,
+                   const std::function<void(std::string_view flag, std::string_view value)>& handle,
+                   std::initializer_list<std::string_view> switches = {});
+
+// Parses the value of a flag as a number, all of it has to be used.
+// Throws std::runtime_error naming the flag otherwise.
+template <typename T>
+T parseNumber(std::string_view flag, std::string_view text) {
+    try {
+        size_t used = 0;
+        T value;
+        if constexpr (std::is_floating_point_v<T>) {
+            value = static_cast<T>(std::stod(std::string(text), &used));
+        } else {
+            value = static_cast<T>(std::stoull(std::string(text), &used, 0));
+        }
+        if (used == text.size()) {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    throw std::runtime_error(fmt::format("Invalid value {} for {}", text, flag));
+}
@@ -1,8 +1,13 @@
 #include <example/particle_demo.h>
 #include <glm/gtc/constants.hpp>
 #include <particlesystem/transform.hpp>
+#include <particlesystem/trace.h>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <imgui.h>
+#include <fmt/format.h>
 
 namespace example {
 
@@ -10,24 +15,21 @@ ParticleDemo::ParticleDemo()
     : placementMode_(PlacementMode::None), 
       selectedType_(SelectedType::None), 
       selectedIndex_(0),
+      snapshotParticles_(true),
+      seed_(ps::CounterRng::defaultSeed),
+      nextStream_(0),
       useBoundaries_(true),
       boundaryRestitution_(0.8f) {
     
     // Initialize the particle system with no emitters
-    // Boundaries are now handled directly in the keepParticlesWithinBounds method
-    
-    // Preallocate rendering data
-    positions_.reserve(1000);
-    colors_.reserve(1000);
-    sizes_.reserve(1000);
-    
-    // Preallocate marker data
-    markerPositions_.reserve(100);
-    markerColors_.reserve(100);
-    markerSizes_.reserve(100);
+    // Boundaries are handled by the system while it integrates the particles
+    if (useBoundaries_) {
+        system_.setBounds(glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f), boundaryRestitution_);
+    }
 }
 
 void ParticleDemo::update(double time, float dt, const glm::vec2& mousePos) {
+    PS_TRACE_SCOPE("ParticleDemo::update");
     // Update all emitters and effects
     for (auto& emitter : emitters_) {
         // Check if it's an explosion emitter that needs to be triggered
@@ -49,110 +51,176 @@ void ParticleDemo::update(double time, float dt, const glm::vec2& mousePos) {
     // Update the particle system
     system_.update(dt);
     
-    // Apply boundary constraints if enabled
-    if (useBoundaries_) {
-        keepParticlesWithinBounds();
+    // Snapshot the particle columns for rendering, unless the renderer reads them directly
+    RenderFrame& frame = frames_.back();
+    if (snapshotParticles_) {
+        system_.getParticleData(frame.positions, frame.colors, frame.sizes);
+    } else {
+        frame.positions.clear();
+        frame.colors.clear();
+        frame.sizes.clear();
     }
     
-    // Get particle data for rendering
-    system_.getParticleData(positions_, colors_, sizes_);
-    
     // Update markers for emitters and effects
-    updateMarkers();
+    updateMarkers(frame);
+    
+    // Hand the finished frame over to the renderer
+    frames_.publish();
+}
+
+const RenderFrame& ParticleDemo::acquireFrame() {
+    frames_.acquire();
+    return frames_.front();
+}
+
+void ParticleDemo::setSnapshotParticles(bool snapshot) {
+    snapshotParticles_ = snapshot;
+}
+
+void ParticleDemo::setRenderBudget(size_t budget) {
+    system_.setRenderBudget(budget);
+}
+
+void ParticleDemo::setCullRect(const glm::vec2& min, const glm::vec2& max) {
+    system_.setCullRect(min, max);
+}
+
+void ParticleDemo::setMaxParticles(size_t max) {
+    system_.setMaxParticles(max);
+}
+
+void ParticleDemo::setThreadCount(size_t count) {
+    system_.setThreadCount(count);
+}
+
+const ps::ParticleSystem& ParticleDemo::getSystem() const {
+    return system_;
 }
 
-void ParticleDemo::keepParticlesWithinBounds() {
-    // Get all particles from the system
-    const auto& particles = system_.getParticles();
+void ParticleDemo::loadScene(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error(fmt::format("Unable to open scene {}", path));
+    }
     
-    // Make a copy we can modify (since getParticles() returns a const reference)
-    std::vector<ps::Particle> updatedParticles = particles;
+    system_.clearEmitters();
+    system_.clearEffects();
+    emitters_.clear();
+    effects_.clear();
+    nextStream_ = 0;
     
-    // Loop through all particles and keep them within bounds [-1, 1] in both x and y
-    for (auto& particle : updatedParticles) {
-        if (!particle.alive) continue;
-        
-        bool bounced = false;
-        
-        // Check and handle X boundaries
-        if (particle.position.x < -1.0f) {
-            particle.position.x = -1.0f;
-            if (particle.velocity.x < 0) {
-                particle.velocity.x = -particle.velocity.x * boundaryRestitution_;
-                bounced = true;
-            }
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        std::istringstream fields(line);
+        std::string type;
+        glm::vec2 position;
+        if (!(fields >> type) || type[0] == '#') {
+            continue;
         }
-        else if (particle.position.x > 1.0f) {
-            particle.position.x = 1.0f;
-            if (particle.velocity.x > 0) {
-                particle.velocity.x = -particle.velocity.x * boundaryRestitution_;
-                bounced = true;
-            }
+        if (!(fields >> position.x >> position.y)) {
+            throw std::runtime_error(fmt::format("{}:{}: expected a position", path, number));
         }
+        float value = 0.0f;
+        const bool hasValue = static_cast<bool>(fields >> value);
         
-        // Check and handle Y boundaries
-        if (particle.position.y < -1.0f) {
-            particle.position.y = -1.0f;
-            if (particle.velocity.y < 0) {
-                particle.velocity.y = -particle.velocity.y * boundaryRestitution_;
-                bounced = true;
-            }
+        if (type == "uniform") {
+            createUniformEmitter(position);
+        } else if (type == "directional") {
+            createDirectionalEmitter(position);
+        } else if (type == "explosion") {
+            createExplosionEmitter(position);
+        } else if (type == "ring") {
+            createRingEmitter(position);
+        } else if (type == "gravitywell") {
+            createGravityWell(position);
+        } else if (type == "wind") {
+            createWind(position);
+        } else {
+            throw std::runtime_error(fmt::format("{}:{}: unknown type {}", path, number, type));
+        }
+        
+        if (!hasValue) {
+            continue;
         }
-        else if (particle.position.y > 1.0f) {
-            particle.position.y = 1.0f;
-            if (particle.velocity.y > 0) {
-                particle.velocity.y = -particle.velocity.y * boundaryRestitution_;
-                bounced = true;
+        if (selectedType_ == SelectedType::Emitter) {
+            auto& emitter = emitters_.back();
+            if (auto explosion = std::dynamic_pointer_cast<ps::ExplosionEmitter>(emitter)) {
+                explosion->setParticleCount(static_cast<int>(value));
+            } else {
+                emitter->setRate(value);
             }
+        } else {
+            effects_.back()->setStrength(value);
         }
     }
     
-    // Update the particle system with our boundary-corrected particles
-    system_.setParticles(updatedParticles);
+    selectedType_ = SelectedType::None;
+    selectedIndex_ = 0;
+}
+
+void ParticleDemo::setSeed(uint64_t seed) {
+    seed_ = seed;
+    for (auto& emitter : emitters_) {
+        emitter->setSeed(seed);
+    }
+}
+
+void ParticleDemo::addParticles(size_t count, float lifetime, uint64_t seed) {
+    // Emitters count their streams up from 0, the last stream is left to these particles
+    const ps::CounterRng rng{seed, UINT32_MAX};
+    std::vector<ps::Particle> particles(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto u = rng.uniform4(0, static_cast<uint32_t>(i));
+        particles[i].position = glm::vec2(u[0], u[1]) * 2.0f - glm::vec2(1.0f, 1.0f);
+        particles[i].velocity = (glm::vec2(u[2], u[3]) - glm::vec2(0.5f, 0.5f)) * 0.2f;
+        particles[i].lifetime = lifetime;
+        particles[i].alive = true;
+    }
+    system_.getSpawnQueue().submit(std::move(particles));
 }
 
 const std::vector<glm::vec2>& ParticleDemo::getPositions() const {
-    return positions_;
+    return frames_.front().positions;
 }
 
 const std::vector<glm::vec4>& ParticleDemo::getColors() const {
-    return colors_;
+    return frames_.front().colors;
 }
 
 const std::vector<float>& ParticleDemo::getSizes() const {
-    return sizes_;
+    return frames_.front().sizes;
 }
 
 const std::vector<glm::vec2>& ParticleDemo::getMarkerPositions() const {
-    return markerPositions_;
+    return frames_.front().markerPositions;
 }
 
 const std::vector<glm::vec4>& ParticleDemo::getMarkerColors() const {
-    return markerColors_;
+    return frames_.front().markerColors;
 }
 
 const std::vector<float>& ParticleDemo::getMarkerSizes() const {
-    return markerSizes_;
+    return frames_.front().markerSizes;
 }
 
-void ParticleDemo::updateMarkers() {
+void ParticleDemo::updateMarkers(RenderFrame& frame) {
     // Clear previous markers
-    markerPositions_.clear();
-    markerColors_.clear();
-    markerSizes_.clear();
+    frame.markerPositions.clear();
+    frame.markerColors.clear();
+    frame.markerSizes.clear();
     
     // Add emitter markers
     for (size_t i = 0; i < emitters_.size(); ++i) {
-        markerPositions_.push_back(emitters_[i]->getPosition());
+        frame.markerPositions.push_back(emitters_[i]->getPosition());
         
         // Selected emitter has a different color/size
         if (selectedType_ == SelectedType::Emitter && selectedIndex_ == i) {
-            markerColors_.push_back(SELECTED_COLOR);
-            markerSizes_.push_back(10.25f);  // Larger marker for selected object
+            frame.markerColors.push_back(SELECTED_COLOR);
+            frame.markerSizes.push_back(10.25f);  // Larger marker for selected object
         } else {
             // All emitters are blue
-            markerColors_.push_back(glm::vec4(0.2f, 0.2f, 0.9f, 1.0f));  // Blue color
-            markerSizes_.push_back(10.20f);  // Bigger marker
+            frame.markerColors.push_back(glm::vec4(0.2f, 0.2f, 0.9f, 1.0f));  // Blue color
+            frame.markerSizes.push_back(10.20f);  // Bigger marker
         }
     }
     
@@ -184,9 +252,9 @@ void ParticleDemo::updateMarkers() {
             // If it's selected, we'll draw an arrow as well
             if (selectedType_ == SelectedType::Effect && selectedIndex_ == i) {
                 // Draw the main marker
-                markerPositions_.push_back(position);
-                markerColors_.push_back(SELECTED_COLOR);
-                markerSizes_.push_back(10.25f);
+                frame.markerPositions.push_back(position);
+                frame.markerColors.push_back(SELECTED_COLOR);
+                frame.markerSizes.push_back(10.25f);
                 
                 // Add an arrow to show direction
                 glm::vec2 dir = wind->getDirection();
@@ -196,14 +264,14 @@ void ParticleDemo::updateMarkers() {
                     dir = dir / len;
                     // Add arrow shaft
                     glm::vec2 arrowEnd = position + dir * 0.15f;
-                    markerPositions_.push_back(arrowEnd);
-                    markerColors_.push_back(SELECTED_COLOR);
-                    markerSizes_.push_back(5.0f);
+                    frame.markerPositions.push_back(arrowEnd);
+                    frame.markerColors.push_back(SELECTED_COLOR);
+                    frame.markerSizes.push_back(5.0f);
                 }
             } else {
-                markerPositions_.push_back(position);
-                markerColors_.push_back(glm::vec4(0.9f, 0.2f, 0.2f, 1.0f));  // Red color
-                markerSizes_.push_back(10.20f);
+                frame.markerPositions.push_back(position);
+                frame.markerColors.push_back(glm::vec4(0.9f, 0.2f, 0.2f, 1.0f));  // Red color
+                frame.markerSizes.push_back(10.20f);
             }
             continue; // Skip the rest of the loop for wind
         }
@@ -211,16 +279,16 @@ void ParticleDemo::updateMarkers() {
         // Skip effects without a clear position
         if (!hasPosition) continue;
         
-        markerPositions_.push_back(position);
+        frame.markerPositions.push_back(position);
         
         // Selected effect has a different color/size
         if (selectedType_ == SelectedType::Effect && selectedIndex_ == i) {
-            markerColors_.push_back(SELECTED_COLOR);
-            markerSizes_.push_back(10.25f);  // Larger marker for selected object
+            frame.markerColors.push_back(SELECTED_COLOR);
+            frame.markerSizes.push_back(10.25f);  // Larger marker for selected object
         } else {
             // All effects are red
-            markerColors_.push_back(glm::vec4(0.9f, 0.2f, 0.2f, 1.0f));  // Red color
-            markerSizes_.push_back(10.20f);  // Bigger marker
+            frame.markerColors.push_back(glm::vec4(0.9f, 0.2f, 0.2f, 1.0f));  // Red color
+            frame.markerSizes.push_back(10.20f);  // Bigger marker
         }
     }
 }
@@ -238,6 +306,9 @@ void ParticleDemo::handleMouseClick(const glm::vec2& mousePos) {
             case PlacementMode::ExplosionEmitter:
                 createExplosionEmitter(mousePos);
                 break;
+            case PlacementMode::RingEmitter:
+                createRingEmitter(mousePos);
+                break;
             case PlacementMode::GravityWell:
                 createGravityWell(mousePos);
                 break;
@@ -264,6 +335,8 @@ void ParticleDemo::setPlacementMode(PlacementMode mode) {
 
 void ParticleDemo::createUniformEmitter(const glm::vec2& position) {
     auto emitter = std::make_shared<ps::UniformEmitter>(position);
+    emitter->setSeed(seed_);
+    emitter->setStream(nextStream_++);
     emitter->setRate(20.0f);
     emitter->setSpeedRange(0.1f, 0.3f);
     emitter->setLifetimeRange(3.0f, 5.0f);
@@ -279,6 +352,8 @@ void ParticleDemo::createUniformEmitter(const glm::vec2& position) {
 void ParticleDemo::createDirectionalEmitter(const glm::vec2& position) {
     // Default direction is upward
     auto emitter = std::make_shared<ps::DirectionalEmitter>(position, glm::vec2(0.0f, 1.0f));
+    emitter->setSeed(seed_);
+    emitter->setStream(nextStream_++);
     emitter->setRate(15.0f);
     emitter->setSpread(glm::pi<float>() / 12.0f);  // 15 degrees
     emitter->setSpeedRange(0.2f, 0.4f);
@@ -294,6 +369,8 @@ void ParticleDemo::createDirectionalEmitter(const glm::vec2& position) {
 
 void ParticleDemo::createExplosionEmitter(const glm::vec2& position) {
     auto emitter = std::make_shared<ps::ExplosionEmitter>(position);
+    emitter->setSeed(seed_);
+    emitter->setStream(nextStream_++);
     emitter->setParticleCount(20);  
     emitter->setSpeedRange(0.3f, 0.7f);
     emitter->setLifetimeRange(1.5f, 2.5f);
@@ -306,6 +383,22 @@ void ParticleDemo::createExplosionEmitter(const glm::vec2& position) {
     selectedIndex_ = emitters_.size() - 1;
 }
 
+void ParticleDemo::createRingEmitter(const glm::vec2& position) {
+    auto emitter = std::make_shared<ps::RingEmitter>(position, 0.2f);
+    emitter->setSeed(seed_);
+    emitter->setStream(nextStream_++);
+    emitter->setRate(60.0f);
+    emitter->setSpeedRange(0.02f, 0.1f);
+    emitter->setLifetimeRange(2.0f, 4.0f);
+    
+    system_.addEmitter(emitter);
+    emitters_.push_back(emitter);
+    
+    // Select the newly created emitter
+    selectedType_ = SelectedType::Emitter;
+    selectedIndex_ = emitters_.size() - 1;
+}
+
 void ParticleDemo::createGravityWell(const glm::vec2& position) {
     auto gravityWell = std::make_shared<ps::GravityWell>(position);
     gravityWell->setStrength(0.1f);
@@ -424,6 +517,9 @@ void ParticleDemo::renderUI() {
             if (ImGui::Button("Explosion Emitter")) {
                 setPlacementMode(PlacementMode::ExplosionEmitter);
             }
+            if (ImGui::Button("Ring Emitter")) {
+                setPlacementMode(PlacementMode::RingEmitter);
+            }
             ImGui::TreePop();
         }
         
@@ -464,6 +560,13 @@ void ParticleDemo::renderUI() {
             emitter->setPosition(position);
         }
         
+        // Evenly spread samples instead of white noise
+        bool lowDiscrepancy = emitter->getSamplingMode() == ps::SamplingMode::LowDiscrepancy;
+        if (ImGui::Checkbox("Low-discrepancy sampling", &lowDiscrepancy)) {
+            emitter->setSamplingMode(lowDiscrepancy ? ps::SamplingMode::LowDiscrepancy
+                                                    : ps::SamplingMode::Random);
+        }
+        
         // Type-specific properties
         auto uniformEmitter = std::dynamic_pointer_cast<ps::UniformEmitter>(emitter);
         if (uniformEmitter) {
@@ -556,6 +659,40 @@ void ParticleDemo::renderUI() {
             }
         }
         
+        auto ringEmitter = std::dynamic_pointer_cast<ps::RingEmitter>(emitter);
+        if (ringEmitter) {
+            ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.2f, 1.0f), "Ring Emitter");
+            
+            float radius = ringEmitter->getRadius();
+            if (ImGui::SliderFloat("Radius", &radius, 0.01f, 1.0f)) {
+                ringEmitter->setRadius(radius);
+            }
+            
+            float thickness = ringEmitter->getThickness();
+            if (ImGui::SliderFloat("Thickness", &thickness, 0.0f, 0.5f)) {
+                ringEmitter->setThickness(thickness);
+            }
+            
+            // Would need access to the private members, so we'll recreate them
+            static float minSpeed = 0.02f;
+            static float maxSpeed = 0.1f;
+            static float minLifetime = 2.0f;
+            static float maxLifetime = 4.0f;
+            
+            if (ImGui::SliderFloat("Min Speed", &minSpeed, 0.0f, maxSpeed)) {
+                ringEmitter->setSpeedRange(minSpeed, maxSpeed);
+            }
+            if (ImGui::SliderFloat("Max Speed", &maxSpeed, minSpeed, 1.0f)) {
+                ringEmitter->setSpeedRange(minSpeed, maxSpeed);
+            }
+            if (ImGui::SliderFloat("Min Lifetime", &minLifetime, 0.1f, maxLifetime)) {
+                ringEmitter->setLifetimeRange(minLifetime, maxLifetime);
+            }
+            if (ImGui::SliderFloat("Max Lifetime", &maxLifetime, minLifetime, 10.0f)) {
+                ringEmitter->setLifetimeRange(minLifetime, maxLifetime);
+            }
+        }
+        
         // Delete button
         if (ImGui::Button("Delete Emitter")) {
             system_.removeEmitter(emitter);
@@ -617,6 +754,51 @@ void ParticleDemo::renderUI() {
             selectedType_ = SelectedType::None;
         }
     }
+    
+    ImGui::Separator();
+    
+    // Live timings and counters of the last update
+    if (ImGui::TreeNode("Update Statistics")) {
+        if constexpr (!ps::UpdateStats::enabled) {
+            ImGui::Text("Build with PARTICLESYSTEM_STATS=ON to collect statistics");
+        } else {
+            const ps::UpdateStats& stats = system_.stats();
+            double total = 0.0;
+            for (size_t phase = 0; phase < ps::UpdateStats::PhaseCount; ++phase) {
+                ImGui::Text("%-14s %8.3f ms", ps::UpdateStats::phaseNames[phase],
+                            stats.phaseSeconds[phase] * 1000.0);
+                total += stats.phaseSeconds[phase];
+            }
+            ImGui::Text("%-14s %8.3f ms", "Total", total * 1000.0);
+            ImGui::Text("Spawned %zu, killed %zu", stats.spawned, stats.killed);
+            ImGui::Text("Capacity %zu, reallocated %zu times", stats.capacity,
+                        stats.capacityChanges);
+            for (size_t i = 0; i < stats.emitterSpawns.size(); ++i) {
+                ImGui::Text("Emitter %zu: %zu spawned", i, stats.emitterSpawns[i]);
+            }
+            for (size_t i = 0; i < stats.effectVisits.size(); ++i) {
+                ImGui::Text("Effect %zu: %zu particles", i, stats.effectVisits[i]);
+            }
+        }
+        ImGui::TreePop();
+    }
+    
+    // Storage of the particle system, to tune capacities with real numbers
+    if (ImGui::TreeNode("Memory")) {
+        const ps::MemoryStats& memory = system_.memoryStats();
+        for (const ps::ColumnMemory& column : memory.columns) {
+            ImGui::Text("%-12s %8zu / %8zu  %8.2f MB (peak %.2f), %zu reallocations",
+                        column.name, column.size, column.capacity,
+                        static_cast<double>(column.bytes) / (1024.0 * 1024.0),
+                        static_cast<double>(column.peakBytes) / (1024.0 * 1024.0),
+                        column.totalReallocations);
+        }
+        ImGui::Text("Total %.2f MB (peak %.2f), %zu reallocations last frame",
+                    static_cast<double>(memory.bytes) / (1024.0 * 1024.0),
+                    static_cast<double>(memory.peakBytes) / (1024.0 * 1024.0),
+                    memory.reallocations);
+        ImGui::TreePop();
+    }
 }
 
 } // namespace example 
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include <example/randomsystem.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace example {
 
 RandomSystem::RandomSystem(size_t numParticles)
@@ -7,21 +10,17 @@ RandomSystem::RandomSystem(size_t numParticles)
     , size(numParticles)
     , color(numParticles)
     , lifetime(numParticles)
-    , gen{[]() {
-        std::random_device rd;  // Will be used to obtain a seed for the random number engine
-        std::mt19937 gen;       // Standard mersenne_twister_engine
-        return gen;
-    }()}
-    , positionDist{-1.0f, 1.0f}  // Position between (-1.0, 1,0) = Screen extent
-    , sizeDist{1.0f, 10.0f}      // Radius between (1.0, 10.0)
-    , colorDist{0.0f, 1.0f}      // Color between (0.0, 1.0) per channel
-    , lifetimeDist{0.5f, 2.5f}   // Lifetime between (0.5, 2.5) seconds
-    , jitterDist{-1.0f, 1.0f}    // Jitter between (-1.0, 1.0) seconds
+    , gen{}  // Batched generator with a fixed default seed
+    , jitter(numParticles)
     , prevTime{0.0} {
-    std::ranges::generate(position, [&]() { return randPosition(); });
-    std::ranges::generate(size, [&]() { return randSize(); });
+    // Position between (-1.0, 1,0) = Screen extent
+    gen.uniform(position, {-1.0f, -1.0f}, {1.0f, 1.0f});
+    // Radius between (1.0, 10.0)
+    gen.uniform(size, 1.0f, 10.0f);
+    // Color between (0.0, 1.0) per channel
     std::ranges::generate(color, [&]() { return randColor(); });
-    std::ranges::generate(lifetime, [&]() { return randLifetime(); });
+    // Lifetime between (0.5, 2.5) seconds
+    gen.uniform(lifetime, 0.5f, 2.5f);
 }
 
 void RandomSystem::update(double time, float speed) {
@@ -35,9 +34,13 @@ void RandomSystem::update(double time, float speed) {
     // Simulation dt may differ from actual dt based on the simulation speed
     const float simDt = static_cast<float>(dt) * speed;
 
+    // Draw the jitter for all particles up front
+    jitter.resize(position.size());
+    randJitter(jitter);
+
     for (size_t i = 0; i < position.size(); ++i) {
         // Apply per particle jitter
-        position[i] += (vel + randJitter()) * simDt;
+        position[i] += (vel + jitter[i]) * simDt;
         color[i].a = std::min(color[i].a, lifetime[i]);  // Modify alpha based on lifetime
         lifetime[i] -= simDt;
 
@@ -0,0 +1,64 @@
+#include <example/simulation_thread.h>
+#include <particlesystem/trace.h>
+
+namespace example {
+
+SimulationThread::SimulationThread(ParticleDemo& demo)
+    : demo_{demo}
+    , pending_{false}
+    , stop_{false}
+    , time_{0.0}
+    , dt_{0.0f}
+    , mousePos_{0.0f, 0.0f}
+    , thread_{[this]() { run(); }} {}
+
+SimulationThread::~SimulationThread() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void SimulationThread::kick(double time, float dt, const glm::vec2& mousePos) {
+    {
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [this]() { return !pending_; });
+        time_ = time;
+        dt_ = dt;
+        mousePos_ = mousePos;
+        pending_ = true;
+    }
+    cv_.notify_all();
+}
+
+void SimulationThread::wait() {
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this]() { return !pending_; });
+}
+
+void SimulationThread::run() {
+    particlesystem::trace::setThreadName("Simulation");
+    std::unique_lock lock{mutex_};
+    while (true) {
+        cv_.wait(lock, [this]() { return pending_ || stop_; });
+        if (stop_) {
+            return;
+        }
+
+        const double time = time_;
+        const float dt = dt_;
+        const glm::vec2 mousePos = mousePos_;
+
+        // The demo is only touched by this thread until pending_ is cleared again
+        lock.unlock();
+        demo_.update(time, dt, mousePos);
+        lock.lock();
+
+        pending_ = false;
+        cv_.notify_all();
+    }
+}
+
+}  // namespace example
@@ -0,0 +1,53 @@
+#include <particlesystem/alias_table.h>
+#include <algorithm>
+
+namespace particlesystem {
+
+void AliasTable::build(std::span<const float> weights) {
+    probability_.clear();
+    alias_.clear();
+    
+    double total = 0.0;
+    for (float weight : weights) {
+        total += std::max(weight, 0.0f);
+    }
+    if (total <= 0.0) {
+        return;
+    }
+    
+    // Scale the weights so the average column holds exactly one unit
+    const size_t count = weights.size();
+    std::vector<double> scaled(count);
+    for (size_t i = 0; i < count; ++i) {
+        scaled[i] = std::max(weights[i], 0.0f) * static_cast<double>(count) / total;
+    }
+    
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < count; ++i) {
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    
+    probability_.assign(count, 1.0f);
+    alias_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        alias_[i] = static_cast<uint32_t>(i);
+    }
+    
+    // Fill each under-full column with the remainder of an over-full one
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+        large.pop_back();
+        
+        probability_[s] = static_cast<float>(scaled[s]);
+        alias_[s] = l;
+        
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        (scaled[l] < 1.0 ? small : large).push_back(l);
+    }
+    // Whatever is left is full up to rounding errors and keeps probability one
+}
+
+} // namespace particlesystem
@@ -1,11 +1,29 @@
 #include <particlesystem/emitter.h>
+#include <particlesystem/transform.hpp>
+#include <particlesystem/trace.h>
+#include <algorithm>
+#include <atomic>
 
 namespace particlesystem {
 
+namespace {
+
+// Hands out a unique random stream to every emitter
+uint32_t nextStream() {
+    static std::atomic<uint32_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
 Emitter::Emitter(const glm::vec2& position)
     : position_(position)
     , rate_(1.0f)
-    , accumulator_(0.0f) {
+    , accumulator_(0.0f)
+    , rng_(CounterRng::defaultSeed, nextStream())
+    , frame_(0)
+    , samplingMode_(SamplingMode::Random)
+    , sequence_(rng_.getSeed(), rng_.getStream()) {
 }
 
 const glm::vec2& Emitter::getPosition() const {
@@ -24,4 +42,82 @@ float Emitter::getRate() const {
     return rate_;
 }
 
+void Emitter::setSeed(uint64_t seed) {
+    rng_.setSeed(seed);
+    sequence_.scramble(rng_.getSeed(), rng_.getStream());
+}
+
+uint64_t Emitter::getSeed() const {
+    return rng_.getSeed();
+}
+
+void Emitter::setStream(uint32_t stream) {
+    rng_.setStream(stream);
+    sequence_.scramble(rng_.getSeed(), rng_.getStream());
+}
+
+uint32_t Emitter::getStream() const {
+    return rng_.getStream();
+}
+
+void Emitter::setSamplingMode(SamplingMode mode) {
+    samplingMode_ = mode;
+}
+
+SamplingMode Emitter::getSamplingMode() const {
+    return samplingMode_;
+}
+
+void Emitter::emit(std::vector<Particle>& particles, float dt) {
+    PS_TRACE_SCOPE("Emitter::emit");
+    const size_t count = spawnCount(dt);
+    if (count == 0) {
+        return;
+    }
+    
+    // Grow the buffer once and fill all new particles in bulk
+    const size_t first = particles.size();
+    particles.resize(first + count);
+    generate(std::span<Particle>(particles).subspan(first));
+    
+    // Next emission draws from a fresh set of counters
+    ++frame_;
+}
+
+size_t Emitter::spawnCount(float dt) {
+    // Accumulate time to control emission rate
+    accumulator_ += dt;
+    if (rate_ <= 0.0f) {
+        return 0;
+    }
+    
+    // Whole particles worth of accumulated time, the remainder carries over
+    const float timePerParticle = 1.0f / rate_;
+    const size_t count = static_cast<size_t>(accumulator_ / timePerParticle);
+    accumulator_ -= static_cast<float>(count) * timePerParticle;
+    
+    return std::min(count, maxSpawnCount);
+}
+
+void Emitter::sample(size_t count) {
+    samples_.resize(count);
+    if (samplingMode_ == SamplingMode::LowDiscrepancy) {
+        sequence_.next(samples_);
+    } else {
+        rng_.uniform4(frame_, 0, samples_);
+    }
+}
+
+void Emitter::sampleDirections(size_t count, float minAngle, float maxAngle) {
+    sample(count);
+    angles_.resize(count);
+    directions_.resize(count);
+    
+    const float range = maxAngle - minAngle;
+    for (size_t i = 0; i < count; ++i) {
+        angles_[i] = minAngle + samples_[i][0] * range;
+    }
+    unitVectors(angles_, directions_);
+}
+
 } // namespace particlesystem 
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include <particlesystem/line_emitter.h>
+#include <particlesystem/transform.hpp>
+#include <utility>
+
+namespace particlesystem {
+
+LineEmitter::LineEmitter(const glm::vec2& position, std::vector<glm::vec2> points, bool closed)
+    : ShapeEmitter(position)
+    , points_(std::move(points))
+    , closed_(closed) {
+    rebuild();
+}
+
+void LineEmitter::setPoints(std::vector<glm::vec2> points, bool closed) {
+    points_ = std::move(points);
+    closed_ = closed;
+    rebuild();
+}
+
+const std::vector<glm::vec2>& LineEmitter::getPoints() const {
+    return points_;
+}
+
+bool LineEmitter::isClosed() const {
+    return closed_;
+}
+
+void LineEmitter::rebuild() {
+    std::vector<Primitive> segments;
+    std::vector<float> lengths;
+    
+    const size_t count = points_.size();
+    const size_t segmentCount = count < 2 ? 0 : (closed_ ? count : count - 1);
+    segments.reserve(segmentCount);
+    lengths.reserve(segmentCount);
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const glm::vec2 edge = points_[(i + 1) % count] - points_[i];
+        segments.push_back({points_[i], edge, glm::vec2(0.0f, 0.0f), false});
+        lengths.push_back(length(edge));
+    }
+    
+    setPrimitives(std::move(segments), lengths);
+}
+
+} // namespace particlesystem
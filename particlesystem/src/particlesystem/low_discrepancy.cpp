@@ -0,0 +1,76 @@
+#include <particlesystem/low_discrepancy.h>
+
+namespace particlesystem {
+
+namespace {
+
+// Van der Corput radical inverse of i in the given base
+float radicalInverse(uint32_t i, uint32_t base) {
+    const double invBase = 1.0 / base;
+    double scale = invBase;
+    double result = 0.0;
+    while (i > 0) {
+        result += (i % base) * scale;
+        i /= base;
+        scale *= invBase;
+    }
+    return static_cast<float>(result);
+}
+
+} // namespace
+
+LowDiscrepancySequence::LowDiscrepancySequence(uint64_t seed, uint32_t stream)
+    : rng_(seed, stream)
+    , offset_{}
+    , index_(0)
+    , cycle_(0) {
+    updateOffset();
+}
+
+void LowDiscrepancySequence::scramble(uint64_t seed, uint32_t stream) {
+    rng_ = CounterRng(seed, stream);
+    index_ = 0;
+    cycle_ = 0;
+    updateOffset();
+}
+
+void LowDiscrepancySequence::next(std::span<Point> out) {
+    const auto& points = table();
+    
+    for (auto& point : out) {
+        const Point& base = points[index_];
+        for (size_t d = 0; d < dimensions; ++d) {
+            // Shift on the torus, wrapping back into [0, 1)
+            const float value = base[d] + offset_[d];
+            point[d] = value >= 1.0f ? value - 1.0f : value;
+        }
+        
+        if (++index_ == tableSize) {
+            index_ = 0;
+            ++cycle_;
+            updateOffset();
+        }
+    }
+}
+
+const std::array<LowDiscrepancySequence::Point, LowDiscrepancySequence::tableSize>&
+LowDiscrepancySequence::table() {
+    static const auto points = []() {
+        constexpr std::array<uint32_t, dimensions> bases = {2, 3, 5, 7};
+        std::array<Point, tableSize> result{};
+        for (uint32_t i = 0; i < tableSize; ++i) {
+            for (size_t d = 0; d < dimensions; ++d) {
+                // Skip the first point, which is zero in every dimension
+                result[i][d] = radicalInverse(i + 1, bases[d]);
+            }
+        }
+        return result;
+    }();
+    return points;
+}
+
+void LowDiscrepancySequence::updateOffset() {
+    offset_ = rng_.uniform4(cycle_, 0);
+}
+
+} // namespace particlesystem
@@ -0,0 +1,71 @@
+#include <particlesystem/mask_emitter.h>
+#include <algorithm>
+#include <utility>
+
+namespace particlesystem {
+
+MaskEmitter::MaskEmitter(const glm::vec2& position, int width, int height,
+                         std::vector<float> mask, float cellSize)
+    : ShapeEmitter(position)
+    , width_(width)
+    , height_(height)
+    , mask_(std::move(mask))
+    , cellSize_(cellSize) {
+    rebuild();
+}
+
+void MaskEmitter::setMask(int width, int height, std::vector<float> mask) {
+    width_ = width;
+    height_ = height;
+    mask_ = std::move(mask);
+    rebuild();
+}
+
+const std::vector<float>& MaskEmitter::getMask() const {
+    return mask_;
+}
+
+int MaskEmitter::getWidth() const {
+    return width_;
+}
+
+int MaskEmitter::getHeight() const {
+    return height_;
+}
+
+void MaskEmitter::setCellSize(float cellSize) {
+    cellSize_ = cellSize;
+    rebuild();
+}
+
+float MaskEmitter::getCellSize() const {
+    return cellSize_;
+}
+
+void MaskEmitter::rebuild() {
+    std::vector<Primitive> cells;
+    std::vector<float> weights;
+    
+    const size_t width = static_cast<size_t>(std::max(width_, 0));
+    const size_t height = static_cast<size_t>(std::max(height_, 0));
+    const size_t count = std::min(width * height, mask_.size());
+    
+    // Only pixels that can emit become primitives, which keeps sparse masks cheap
+    const glm::vec2 topLeft(-0.5f * static_cast<float>(width) * cellSize_,
+                            0.5f * static_cast<float>(height) * cellSize_);
+    const glm::vec2 right(cellSize_, 0.0f);
+    const glm::vec2 down(0.0f, -cellSize_);
+    for (size_t i = 0; i < count; ++i) {
+        if (mask_[i] <= 0.0f) {
+            continue;
+        }
+        const float column = static_cast<float>(i % width);
+        const float row = static_cast<float>(i / width);
+        cells.push_back({topLeft + column * right + row * down, right, down, false});
+        weights.push_back(mask_[i]);
+    }
+    
+    setPrimitives(std::move(cells), weights);
+}
+
+} // namespace particlesystem
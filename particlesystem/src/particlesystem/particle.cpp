@@ -7,7 +7,8 @@ Particle::Particle()
     , velocity(0.0f, 0.0f)
     , force(0.0f, 0.0f)
     , lifetime(0.0f)
-    , alive(false) {
+    , alive(false)
+    , id(0) {
 }
 
 void Particle::update(float dt) {
@@ -1,47 +1,364 @@
 #include <particlesystem/particlesystem.h>
+#include <particlesystem/random.h>
+#include <particlesystem/trace.h>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/common.hpp>
+#include <cstddef>
 
 namespace particlesystem {
 
-ParticleSystem::ParticleSystem() {
+namespace {
+
+// Render attributes derived from the particle state
+// Color fades out and size shrinks slightly over the last two seconds of life
+glm::vec4 particleColor(const Particle& particle) {
+    const float lifeFactor = std::min(1.0f, particle.lifetime / 2.0f);
+    return glm::vec4(1.0f, 1.0f, 1.0f, lifeFactor);
+}
+
+float particleSize(const Particle& particle) {
+    const float lifeFactor = std::min(1.0f, particle.lifetime / 2.0f);
+    return 0.02f + 0.02f * lifeFactor;
+}
+
+// Uniform number in [0, 1) fixed for a particle id, decides whether it is rendered
+float keepThreshold(uint32_t id) {
+    // Finalizer of MurmurHash3, consecutive ids give unrelated values
+    id ^= id >> 16;
+    id *= 0x85EBCA6Bu;
+    id ^= id >> 13;
+    id *= 0xC2B2AE35u;
+    id ^= id >> 16;
+    return toUnitFloat(id);
+}
+
+// Sets the size and capacity of a column and counts a reallocation if the capacity changed
+void accountColumn(ColumnMemory& column, size_t size, size_t capacity, size_t elementSize) {
+    column.reallocations = capacity != column.capacity ? 1 : 0;
+    column.totalReallocations += column.reallocations;
+    column.size = size;
+    column.capacity = capacity;
+    column.bytes = capacity * elementSize;
+    column.peakBytes = std::max(column.peakBytes, column.bytes);
+}
+
+template <typename T>
+void accountColumn(ColumnMemory& column, const std::vector<T>& storage) {
+    accountColumn(column, storage.size(), storage.capacity(), sizeof(T));
+}
+
+// Copies a column, growing the destination geometrically so that a slowly rising particle
+// count does not reallocate it on every frame
+template <typename T>
+void copyColumn(std::vector<T>& destination, const std::vector<T>& source) {
+    if (destination.capacity() < source.size()) {
+        destination.reserve(std::max(source.size(), 2 * destination.capacity()));
+    }
+    destination.assign(source.begin(), source.end());
+}
+
+} // namespace
+
+ParticleSystem::ParticleSystem()
+    : aliveCount_(0)
+    , maxParticles_(defaultMaxParticles)
+    , renderBudget_(0)
+    , nextId_(0)
+    , culled_(false)
+    , cullRect_{glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f)}
+    , bounded_(false)
+    , boundsMin_(-1.0f, -1.0f)
+    , boundsMax_(1.0f, 1.0f)
+    , restitution_(1.0f) {
     // Initialize with reasonable default capacity
     particles_.reserve(1000);
     emitters_.reserve(10);
     effects_.reserve(10);
+    
+    for (size_t c = 0; c < MemoryStats::ColumnCount; ++c) {
+        memory_.columns[c].name = MemoryStats::columnNames[c];
+    }
 }
 
 void ParticleSystem::update(float dt) {
-    // Step 1: Emit new particles from all emitters
-    for (auto& emitter : emitters_) {
-        emitter->emit(particles_, dt);
+    PS_TRACE_SCOPE("ParticleSystem::update");
+    PS_STATS(
+        const size_t previousCapacity = particles_.capacity();
+        stats_.phaseSeconds.fill(0.0);
+        stats_.emitterSpawns.assign(emitters_.size(), 0);
+        stats_.effectVisits.assign(effects_.size(), 0);
+    )
+    
+    // Step 1: Emit new particles from all emitters into their own staging buffers,
+    // then append everything, including particles queued from other threads, at once
+    {
+        PS_TRACE_SCOPE("Emit");
+        PS_STATS(PhaseTimer timer{stats_.phaseSeconds[UpdateStats::Emit]};)
+        staging_.resize(emitters_.size());
+        workers_.parallelFor(emitters_.size(), [&](size_t i) {
+            staging_[i].clear();
+            emitters_[i]->emit(staging_[i], dt);
+            PS_STATS(stats_.emitterSpawns[i] = staging_[i].size();)
+        });
+    }
+    {
+        PS_TRACE_SCOPE("Merge");
+        PS_STATS(PhaseTimer timer{stats_.phaseSeconds[UpdateStats::Merge]};)
+        PS_STATS(const size_t before = particles_.size();)
+        mergeSpawns();
+        PS_STATS(stats_.spawned = particles_.size() - before;)
     }
     
     // Step 2: Reset forces on all particles
-    for (auto& particle : particles_) {
-        particle.resetForce();
+    {
+        PS_TRACE_SCOPE("Reset forces");
+        PS_STATS(PhaseTimer timer{stats_.phaseSeconds[UpdateStats::ResetForces]};)
+        for (auto& particle : particles_) {
+            particle.resetForce();
+        }
     }
     
     // Step 3: Apply all effects to all particles
-    for (auto& effect : effects_) {
-        if (effect->isEnabled()) {
-            for (auto& particle : particles_) {
-                if (particle.alive) {
-                    effect->apply(particle);
+    {
+        PS_TRACE_SCOPE("Effects");
+        PS_STATS(PhaseTimer timer{stats_.phaseSeconds[UpdateStats::Effects]};)
+        for (size_t e = 0; e < effects_.size(); ++e) {
+            Effect& effect = *effects_[e];
+            if (effect.isEnabled()) {
+                PS_TRACE_SCOPE("Effect::apply");
+                for (auto& particle : particles_) {
+                    if (particle.alive) {
+                        effect.apply(particle);
+                        PS_STATS(++stats_.effectVisits[e];)
+                    }
                 }
             }
         }
     }
     
-    // Step 4: Update all particles (move and age them)
-    for (auto& particle : particles_) {
+    // Step 4: Move and age all particles, keep them within bounds, remove dead ones and
+    // write the render columns, all in a single pass over the particles
+    integrate(dt);
+    
+    // Step 5: Reduce the render columns to what will be drawn
+    {
+        PS_TRACE_SCOPE("Export");
+        PS_STATS(PhaseTimer timer{stats_.phaseSeconds[UpdateStats::Export]};)
+        applyCullRect();
+        applyRenderBudget();
+    }
+    
+    PS_STATS(
+        stats_.capacity = particles_.capacity();
+        if (stats_.capacity != previousCapacity) {
+            ++stats_.capacityChanges;
+        }
+    )
+    updateMemoryStats();
+}
+
+void ParticleSystem::integrate(float dt) {
+    PS_TRACE_SCOPE("Integrate");
+    PS_STATS(PhaseTimer timer{stats_.phaseSeconds[UpdateStats::Integrate]};)
+    positions_.resize(particles_.size());
+    colors_.resize(particles_.size());
+    sizes_.resize(particles_.size());
+    ids_.resize(particles_.size());
+    blockBounds_.clear();
+    
+    size_t alive = 0;
+    for (size_t i = 0; i < particles_.size(); ++i) {
+        Particle particle = particles_[i];
         particle.update(dt);
+        if (!particle.alive) {
+            continue;
+        }
+        if (bounded_) {
+            bounce(particle);
+        }
+        
+        particles_[alive] = particle;
+        positions_[alive] = particle.position;
+        colors_[alive] = particleColor(particle);
+        sizes_[alive] = particleSize(particle);
+        ids_[alive] = particle.id;
+        if (culled_) {
+            growBlockBounds(alive, particle.position);
+        }
+        ++alive;
+    }
+    
+    PS_STATS(stats_.killed = particles_.size() - alive;)
+    particles_.erase(particles_.begin() + static_cast<std::ptrdiff_t>(alive), particles_.end());
+    positions_.resize(alive);
+    colors_.resize(alive);
+    sizes_.resize(alive);
+    ids_.resize(alive);
+    aliveCount_ = alive;
+}
+
+void ParticleSystem::bounce(Particle& particle) const {
+    for (int axis = 0; axis < 2; ++axis) {
+        float& position = particle.position[axis];
+        float& velocity = particle.velocity[axis];
+        if (position < boundsMin_[axis]) {
+            position = boundsMin_[axis];
+            if (velocity < 0.0f) {
+                velocity = -velocity * restitution_;
+            }
+        } else if (position > boundsMax_[axis]) {
+            position = boundsMax_[axis];
+            if (velocity > 0.0f) {
+                velocity = -velocity * restitution_;
+            }
+        }
+    }
+}
+
+void ParticleSystem::refreshRenderData() {
+    positions_.clear();
+    colors_.clear();
+    sizes_.clear();
+    ids_.clear();
+    blockBounds_.clear();
+    for (const auto& particle : particles_) {
+        if (particle.alive) {
+            if (culled_) {
+                growBlockBounds(positions_.size(), particle.position);
+            }
+            positions_.push_back(particle.position);
+            colors_.push_back(particleColor(particle));
+            sizes_.push_back(particleSize(particle));
+            ids_.push_back(particle.id);
+        }
+    }
+    aliveCount_ = positions_.size();
+    applyCullRect();
+    applyRenderBudget();
+}
+
+void ParticleSystem::growBlockBounds(size_t index, const glm::vec2& position) {
+    if (index % cullBlockSize == 0) {
+        blockBounds_.push_back({position, position});
+        return;
+    }
+    Bounds& bounds = blockBounds_.back();
+    bounds.min = glm::min(bounds.min, position);
+    bounds.max = glm::max(bounds.max, position);
+}
+
+void ParticleSystem::moveRenderEntry(size_t from, size_t to) {
+    positions_[to] = positions_[from];
+    colors_[to] = colors_[from];
+    sizes_[to] = sizes_[from];
+    ids_[to] = ids_[from];
+}
+
+void ParticleSystem::applyCullRect() {
+    if (!culled_) {
+        return;
+    }
+    
+    const auto inside = [this](const glm::vec2& p) {
+        return p.x >= cullRect_.min.x && p.x <= cullRect_.max.x &&
+               p.y >= cullRect_.min.y && p.y <= cullRect_.max.y;
+    };
+    
+    const size_t count = positions_.size();
+    size_t kept = 0;
+    for (size_t block = 0; block < blockBounds_.size(); ++block) {
+        const Bounds& bounds = blockBounds_[block];
+        const size_t begin = block * cullBlockSize;
+        const size_t end = std::min(begin + cullBlockSize, count);
+        
+        // Whole block outside, skip it without looking at the particles
+        if (bounds.max.x < cullRect_.min.x || bounds.min.x > cullRect_.max.x ||
+            bounds.max.y < cullRect_.min.y || bounds.min.y > cullRect_.max.y) {
+            continue;
+        }
+        
+        // Whole block inside, keep all of it
+        if (inside(bounds.min) && inside(bounds.max)) {
+            if (kept != begin) {
+                for (size_t i = begin; i < end; ++i) {
+                    moveRenderEntry(i, kept + (i - begin));
+                }
+            }
+            kept += end - begin;
+            continue;
+        }
+        
+        for (size_t i = begin; i < end; ++i) {
+            if (inside(positions_[i])) {
+                moveRenderEntry(i, kept++);
+            }
+        }
+    }
+    positions_.resize(kept);
+    colors_.resize(kept);
+    sizes_.resize(kept);
+    ids_.resize(kept);
+}
+
+void ParticleSystem::applyRenderBudget() {
+    const size_t count = positions_.size();
+    if (renderBudget_ == 0 || count <= renderBudget_) {
+        return;
+    }
+    
+    // Priority sampling: keep the budget particles with the smallest keepThreshold / importance.
+    // The threshold of a particle is fixed by its id, so the same particles are kept from frame
+    // to frame and a new particle only displaces the particle with the largest key.
+    budgetKeys_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const float importance = colors_[i].a * sizes_[i];
+        const float key = importance > 0.0f ? keepThreshold(ids_[i]) / importance
+                                            : std::numeric_limits<float>::infinity();
+        budgetKeys_[i] = {key, static_cast<uint32_t>(i)};
     }
+    const auto byKey = [this](const BudgetKey& a, const BudgetKey& b) {
+        return a.key < b.key || (a.key == b.key && ids_[a.index] < ids_[b.index]);
+    };
+    const auto last = budgetKeys_.begin() + static_cast<std::ptrdiff_t>(renderBudget_);
+    std::nth_element(budgetKeys_.begin(), last, budgetKeys_.end(), byKey);
     
-    // Step 5: Remove dead particles
-    particles_.erase(
-        std::remove_if(particles_.begin(), particles_.end(), 
-                      [](const Particle& p) { return !p.alive; }),
-        particles_.end());
+    // The smallest key left out is the threshold. A kept particle is one of about
+    // 1 / probability particles of its importance, with probability = min(1, importance * threshold)
+    const float threshold = last->key;
+    std::sort(budgetKeys_.begin(), last,
+              [](const BudgetKey& a, const BudgetKey& b) { return a.index < b.index; });
+    
+    size_t kept = 0;
+    for (auto key = budgetKeys_.begin(); key != last; ++key) {
+        const size_t i = key->index;
+        
+        // Each kept particle stands in for 1 / probability particles, so its coverage
+        // (alpha times area) grows by that much
+        glm::vec4 color = colors_[i];
+        float size = sizes_[i];
+        const float importance = color.a * size;
+        const float probability =
+            importance > 0.0f ? std::min(1.0f, importance * threshold) : 1.0f;
+        const float alpha = color.a / probability;
+        if (alpha > 1.0f) {
+            color.a = 1.0f;
+            size *= std::sqrt(alpha);
+        } else {
+            color.a = alpha;
+        }
+        
+        positions_[kept] = positions_[i];
+        colors_[kept] = color;
+        sizes_[kept] = size;
+        ids_[kept] = ids_[i];
+        ++kept;
+    }
+    positions_.resize(kept);
+    colors_.resize(kept);
+    sizes_.resize(kept);
+    ids_.resize(kept);
 }
 
 void ParticleSystem::addEmitter(std::shared_ptr<Emitter> emitter) {
@@ -72,6 +389,47 @@ void ParticleSystem::removeEffect(std::shared_ptr<Effect> effect) {
     }
 }
 
+void ParticleSystem::mergeSpawns() {
+    // Emitted particles beyond the particle limit are dropped, earlier emitters first
+    size_t room = maxParticles_ > particles_.size() ? maxParticles_ - particles_.size() : 0;
+    size_t count = 0;
+    for (size_t i = 0; i < staging_.size(); ++i) {
+        std::vector<Particle>& staged = staging_[i];
+        staged.resize(std::min(staged.size(), room));
+        room -= staged.size();
+        count += staged.size();
+        PS_STATS(stats_.emitterSpawns[i] = staged.size();)
+    }
+    
+    // Grow geometrically, an exact reserve would reallocate on every frame
+    const size_t required = particles_.size() + count;
+    if (required > particles_.capacity()) {
+        particles_.reserve(std::max(required, 2 * particles_.capacity()));
+    }
+    
+    const size_t first = particles_.size();
+    for (const auto& staged : staging_) {
+        particles_.insert(particles_.end(), staged.begin(), staged.end());
+    }
+    spawnQueue_.drain(particles_);
+    
+    for (size_t i = first; i < particles_.size(); ++i) {
+        particles_[i].id = nextId_++;
+    }
+}
+
+SpawnQueue& ParticleSystem::getSpawnQueue() {
+    return spawnQueue_;
+}
+
+void ParticleSystem::setThreadCount(size_t count) {
+    workers_.setThreadCount(count);
+}
+
+size_t ParticleSystem::getThreadCount() const {
+    return workers_.threadCount();
+}
+
 const std::vector<Particle>& ParticleSystem::getParticles() const {
     return particles_;
 }
@@ -79,33 +437,113 @@ const std::vector<Particle>& ParticleSystem::getParticles() const {
 void ParticleSystem::setParticles(const std::vector<Particle>& particles) {
     // Replace the current particles with the provided ones
     particles_ = particles;
+    refreshRenderData();
 }
 
 void ParticleSystem::getParticleData(std::vector<glm::vec2>& positions, std::vector<glm::vec4>& colors, std::vector<float>& sizes) const {
-    // Clear the output vectors
-    positions.clear();
-    colors.clear();
-    sizes.clear();
+    // The columns are already up to date, so this is a plain bulk copy
+    copyColumn(positions, positions_);
+    copyColumn(colors, colors_);
+    copyColumn(sizes, sizes_);
+}
+
+std::span<const glm::vec2> ParticleSystem::getPositions() const {
+    return positions_;
+}
+
+std::span<const glm::vec4> ParticleSystem::getColors() const {
+    return colors_;
+}
+
+std::span<const float> ParticleSystem::getSizes() const {
+    return sizes_;
+}
+
+const UpdateStats& ParticleSystem::stats() const {
+    return stats_;
+}
+
+const MemoryStats& ParticleSystem::memoryStats() const {
+    return memory_;
+}
+
+void ParticleSystem::updateMemoryStats() {
+    accountColumn(memory_.columns[MemoryStats::Particles], particles_);
+    accountColumn(memory_.columns[MemoryStats::Positions], positions_);
+    accountColumn(memory_.columns[MemoryStats::Colors], colors_);
+    accountColumn(memory_.columns[MemoryStats::Sizes], sizes_);
+    accountColumn(memory_.columns[MemoryStats::Ids], ids_);
+    accountColumn(memory_.columns[MemoryStats::BlockBounds], blockBounds_);
     
-    // Reserve space for efficiency
-    positions.reserve(particles_.size());
-    colors.reserve(particles_.size());
-    sizes.reserve(particles_.size());
+    size_t stagingSize = 0;
+    size_t stagingCapacity = 0;
+    for (const auto& staging : staging_) {
+        stagingSize += staging.size();
+        stagingCapacity += staging.capacity();
+    }
+    accountColumn(memory_.columns[MemoryStats::Staging], stagingSize, stagingCapacity,
+                  sizeof(Particle));
+    accountColumn(memory_.columns[MemoryStats::BudgetKeys], budgetKeys_);
     
-    // Add data from all alive particles
-    for (const auto& particle : particles_) {
-        if (particle.alive) {
-            positions.push_back(particle.position);
-            
-            // Calculate color based on lifetime (fade out as they age)
-            // This is just an example - could be customized or moved elsewhere
-            float lifeFactor = std::min(1.0f, particle.lifetime / 2.0f);
-            colors.push_back(glm::vec4(1.0f, 1.0f, 1.0f, lifeFactor));
-            
-            // Size decreases slightly with age
-            sizes.push_back(0.02f + 0.02f * lifeFactor);
-        }
+    memory_.bytes = 0;
+    memory_.reallocations = 0;
+    for (const ColumnMemory& column : memory_.columns) {
+        memory_.bytes += column.bytes;
+        memory_.reallocations += column.reallocations;
     }
+    memory_.peakBytes = std::max(memory_.peakBytes, memory_.bytes);
+}
+
+size_t ParticleSystem::getAliveCount() const {
+    return aliveCount_;
+}
+
+size_t ParticleSystem::getRenderCount() const {
+    return positions_.size();
+}
+
+void ParticleSystem::setRenderBudget(size_t budget) {
+    renderBudget_ = budget;
+}
+
+void ParticleSystem::setMaxParticles(size_t max) {
+    maxParticles_ = max;
+}
+
+size_t ParticleSystem::getMaxParticles() const {
+    return maxParticles_;
+}
+
+size_t ParticleSystem::getRenderBudget() const {
+    return renderBudget_;
+}
+
+void ParticleSystem::setCullRect(const glm::vec2& min, const glm::vec2& max) {
+    culled_ = true;
+    cullRect_ = {min, max};
+}
+
+void ParticleSystem::clearCullRect() {
+    culled_ = false;
+}
+
+bool ParticleSystem::hasCullRect() const {
+    return culled_;
+}
+
+void ParticleSystem::setBounds(const glm::vec2& min, const glm::vec2& max, float restitution) {
+    bounded_ = true;
+    boundsMin_ = min;
+    boundsMax_ = max;
+    restitution_ = restitution;
+}
+
+void ParticleSystem::clearBounds() {
+    bounded_ = false;
+}
+
+bool ParticleSystem::hasBounds() const {
+    return bounded_;
 }
 
 void ParticleSystem::reserve(size_t capacity) {
@@ -114,6 +552,7 @@ void ParticleSystem::reserve(size_t capacity) {
 
 void ParticleSystem::clearParticles() {
     particles_.clear();
+    refreshRenderData();
 }
 
 void ParticleSystem::clearEmitters() {
@@ -0,0 +1,102 @@
+#include <particlesystem/polygon_emitter.h>
+#include <particlesystem/transform.hpp>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+namespace particlesystem {
+
+namespace {
+
+// True if p lies inside or on the triangle abc with counter-clockwise winding
+bool insideTriangle(glm::vec2 p, glm::vec2 a, glm::vec2 b, glm::vec2 c) {
+    return cross(b - a, p - a) >= 0.0f && cross(c - b, p - b) >= 0.0f &&
+           cross(a - c, p - c) >= 0.0f;
+}
+
+} // namespace
+
+PolygonEmitter::PolygonEmitter(const glm::vec2& position, std::vector<glm::vec2> vertices)
+    : ShapeEmitter(position)
+    , vertices_(std::move(vertices))
+    , outline_(false) {
+    rebuild();
+}
+
+void PolygonEmitter::setVertices(std::vector<glm::vec2> vertices) {
+    vertices_ = std::move(vertices);
+    rebuild();
+}
+
+const std::vector<glm::vec2>& PolygonEmitter::getVertices() const {
+    return vertices_;
+}
+
+void PolygonEmitter::setOutline(bool outline) {
+    outline_ = outline;
+    rebuild();
+}
+
+bool PolygonEmitter::getOutline() const {
+    return outline_;
+}
+
+void PolygonEmitter::rebuild() {
+    std::vector<Primitive> primitives;
+    std::vector<float> weights;
+    const size_t count = vertices_.size();
+    
+    if (outline_) {
+        for (size_t i = 0; count >= 2 && i < count; ++i) {
+            const glm::vec2 edge = vertices_[(i + 1) % count] - vertices_[i];
+            primitives.push_back({vertices_[i], edge, glm::vec2(0.0f, 0.0f), false});
+            weights.push_back(length(edge));
+        }
+        setPrimitives(std::move(primitives), weights);
+        return;
+    }
+    
+    // Work on a counter-clockwise list of remaining vertex indices
+    float area = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        area += cross(vertices_[i], vertices_[(i + 1) % count]);
+    }
+    std::vector<size_t> remaining(count);
+    for (size_t i = 0; i < count; ++i) {
+        remaining[i] = area >= 0.0f ? i : count - 1 - i;
+    }
+    
+    // Ear clipping: repeatedly cut off a convex corner that contains no other vertex
+    size_t attempts = 0;
+    size_t i = 0;
+    while (remaining.size() >= 3 && attempts < remaining.size()) {
+        const size_t n = remaining.size();
+        const glm::vec2 a = vertices_[remaining[(i + n - 1) % n]];
+        const glm::vec2 b = vertices_[remaining[i % n]];
+        const glm::vec2 c = vertices_[remaining[(i + 1) % n]];
+        
+        bool ear = cross(b - a, c - b) > 0.0f;
+        for (size_t j = 0; ear && j < n; ++j) {
+            const glm::vec2 p = vertices_[remaining[j]];
+            if (p != a && p != b && p != c && insideTriangle(p, a, b, c)) {
+                ear = false;
+            }
+        }
+        
+        if (!ear) {
+            i = (i + 1) % n;
+            ++attempts;
+            continue;
+        }
+        
+        primitives.push_back({a, b - a, c - a, true});
+        weights.push_back(0.5f * std::abs(cross(b - a, c - a)));
+        remaining.erase(remaining.begin() + static_cast<std::ptrdiff_t>(i % n));
+        i = i % remaining.size();
+        attempts = 0;
+    }
+    
+    setPrimitives(std::move(primitives), weights);
+}
+
+} // namespace particlesystem
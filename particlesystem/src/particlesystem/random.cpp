@@ -0,0 +1,113 @@
+#include <particlesystem/random.h>
+#include <particlesystem/transform.hpp>
+#include <algorithm>
+
+namespace particlesystem {
+
+namespace {
+
+// Expands a single seed into well mixed state words
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+BatchRng::BatchRng(uint64_t seed)
+    : buffered_(0) {
+    this->seed(seed);
+}
+
+void BatchRng::seed(uint64_t seed) {
+    uint64_t state = seed;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        const uint64_t a = splitmix64(state);
+        const uint64_t b = splitmix64(state);
+        s0_[lane] = static_cast<uint32_t>(a);
+        s1_[lane] = static_cast<uint32_t>(a >> 32);
+        s2_[lane] = static_cast<uint32_t>(b);
+        s3_[lane] = static_cast<uint32_t>(b >> 32);
+    }
+    buffered_ = 0;
+}
+
+void BatchRng::step(float* out) {
+    // xoshiro128+ on every lane, written so the compiler turns the loop into vector code
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        const uint32_t result = s0_[lane] + s3_[lane];
+        const uint32_t t = s1_[lane] << 9;
+        s2_[lane] ^= s0_[lane];
+        s3_[lane] ^= s1_[lane];
+        s1_[lane] ^= s2_[lane];
+        s0_[lane] ^= s3_[lane];
+        s2_[lane] ^= t;
+        s3_[lane] = (s3_[lane] << 11) | (s3_[lane] >> 21);
+        out[lane] = toUnitFloat(result);
+    }
+}
+
+float BatchRng::next(float min, float max) {
+    if (buffered_ == 0) {
+        step(buffer_.data());
+        buffered_ = lanes;
+    }
+    return min + buffer_[--buffered_] * (max - min);
+}
+
+void BatchRng::uniform(std::span<float> out, float min, float max) {
+    const float scale = max - min;
+    alignas(32) std::array<float, lanes> block;
+    
+    size_t i = 0;
+    for (; i + lanes <= out.size(); i += lanes) {
+        step(block.data());
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            out[i + lane] = min + block[lane] * scale;
+        }
+    }
+    for (; i < out.size(); ++i) {
+        out[i] = next(min, max);
+    }
+}
+
+void BatchRng::uniform(std::span<glm::vec2> out, glm::vec2 min, glm::vec2 max) {
+    const glm::vec2 scale = max - min;
+    alignas(32) std::array<float, lanes> block;
+    
+    // Each block of random numbers provides the coordinates of lanes / 2 points
+    constexpr size_t points = lanes / 2;
+    size_t i = 0;
+    for (; i + points <= out.size(); i += points) {
+        step(block.data());
+        for (size_t p = 0; p < points; ++p) {
+            out[i + p] = glm::vec2(min.x + block[2 * p] * scale.x,
+                                   min.y + block[2 * p + 1] * scale.y);
+        }
+    }
+    for (; i < out.size(); ++i) {
+        const float x = next(min.x, max.x);
+        const float y = next(min.y, max.y);
+        out[i] = glm::vec2(x, y);
+    }
+}
+
+void BatchRng::unitVectors(std::span<glm::vec2> out, float minAngle, float maxAngle) {
+    const float scale = maxAngle - minAngle;
+    alignas(32) std::array<float, lanes> block;
+    
+    size_t i = 0;
+    for (; i + lanes <= out.size(); i += lanes) {
+        step(block.data());
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            out[i + lane] = unitVector(minAngle + block[lane] * scale);
+        }
+    }
+    for (; i < out.size(); ++i) {
+        out[i] = unitVector(next(minAngle, maxAngle));
+    }
+}
+
+} // namespace particlesystem
@@ -0,0 +1,85 @@
+#include <particlesystem/ring_emitter.h>
+#include <particlesystem/transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace particlesystem {
+
+RingEmitter::RingEmitter(const glm::vec2& position, float radius, float thickness, int segments)
+    : ShapeEmitter(position)
+    , radius_(radius)
+    , thickness_(thickness)
+    , segments_(segments) {
+    rebuild();
+}
+
+void RingEmitter::setRadius(float radius) {
+    radius_ = radius;
+    rebuild();
+}
+
+float RingEmitter::getRadius() const {
+    return radius_;
+}
+
+void RingEmitter::setThickness(float thickness) {
+    thickness_ = thickness;
+    rebuild();
+}
+
+float RingEmitter::getThickness() const {
+    return thickness_;
+}
+
+void RingEmitter::setSegments(int segments) {
+    segments_ = segments;
+    rebuild();
+}
+
+int RingEmitter::getSegments() const {
+    return segments_;
+}
+
+void RingEmitter::rebuild() {
+    const int segments = std::max(segments_, 3);
+    const float halfThickness = std::max(thickness_, 0.0f) * 0.5f;
+    const float inner = std::max(radius_ - halfThickness, 0.0f);
+    const float outer = std::max(radius_ + halfThickness, 0.0f);
+    const bool outline = outer - inner <= 0.0f;
+    
+    std::vector<Primitive> primitives;
+    std::vector<float> weights;
+    const size_t reserved = static_cast<size_t>(segments) * (outline ? 1 : 2);
+    primitives.reserve(reserved);
+    weights.reserve(reserved);
+    
+    const float step = 2.0f * glm::pi<float>() / static_cast<float>(segments);
+    for (int i = 0; i < segments; ++i) {
+        const glm::vec2 a = unitVector(static_cast<float>(i) * step);
+        const glm::vec2 b = unitVector(static_cast<float>(i + 1) * step);
+        
+        if (outline) {
+            // A chord of the circle, weighted by its length
+            const glm::vec2 edge = (b - a) * outer;
+            primitives.push_back({a * outer, edge, glm::vec2(0.0f, 0.0f), false});
+            weights.push_back(length(edge));
+            continue;
+        }
+        
+        // The annulus piece between a and b is a trapezoid, split into two triangles
+        const glm::vec2 p0 = a * inner;
+        const glm::vec2 p1 = a * outer;
+        const glm::vec2 p2 = b * outer;
+        const glm::vec2 p3 = b * inner;
+        primitives.push_back({p0, p1 - p0, p2 - p0, true});
+        weights.push_back(0.5f * std::abs(cross(p1 - p0, p2 - p0)));
+        primitives.push_back({p0, p2 - p0, p3 - p0, true});
+        weights.push_back(0.5f * std::abs(cross(p2 - p0, p3 - p0)));
+    }
+    
+    setPrimitives(std::move(primitives), weights);
+}
+
+} // namespace particlesystem
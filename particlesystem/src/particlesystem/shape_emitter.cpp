@@ -0,0 +1,81 @@
+#include <particlesystem/shape_emitter.h>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <utility>
+
+namespace particlesystem {
+
+ShapeEmitter::ShapeEmitter(const glm::vec2& position)
+    : Emitter(position)
+    , minSpeed_(1.0f)
+    , maxSpeed_(2.0f)
+    , minLifetime_(1.0f)
+    , maxLifetime_(3.0f) {
+}
+
+void ShapeEmitter::setSpeedRange(float minSpeed, float maxSpeed) {
+    minSpeed_ = minSpeed;
+    maxSpeed_ = maxSpeed;
+}
+
+void ShapeEmitter::setLifetimeRange(float minLifetime, float maxLifetime) {
+    minLifetime_ = minLifetime;
+    maxLifetime_ = maxLifetime;
+}
+
+size_t ShapeEmitter::getPrimitiveCount() const {
+    return primitives_.size();
+}
+
+void ShapeEmitter::setPrimitives(std::vector<Primitive> primitives,
+                                 std::span<const float> weights) {
+    primitives_ = std::move(primitives);
+    table_.build(weights.first(std::min(weights.size(), primitives_.size())));
+}
+
+void ShapeEmitter::samplePositions(size_t count) {
+    positions_.resize(count);
+    if (table_.empty()) {
+        std::fill(positions_.begin(), positions_.end(), glm::vec2(0.0f, 0.0f));
+        return;
+    }
+    
+    // A second block of counters keeps positions independent of angle, speed and lifetime
+    positionSamples_.resize(count);
+    rng_.uniform4(frame_, 0, positionSamples_, 1);
+    
+    const bool stratified = samplingMode_ == SamplingMode::LowDiscrepancy;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& r = positionSamples_[i];
+        const float column = stratified ? samples_[i][3] : r[0];
+        const Primitive& primitive = primitives_[table_.sample(column, r[1])];
+        
+        // Fold the far half of the parallelogram back onto the triangle
+        float u = r[2];
+        float v = r[3];
+        if (primitive.triangle && u + v > 1.0f) {
+            u = 1.0f - u;
+            v = 1.0f - v;
+        }
+        positions_[i] = primitive.origin + u * primitive.edge0 + v * primitive.edge1;
+    }
+}
+
+void ShapeEmitter::generate(std::span<Particle> particles) {
+    sampleDirections(particles.size(), 0.0f, 2.0f * glm::pi<float>());
+    samplePositions(particles.size());
+    
+    for (size_t i = 0; i < particles.size(); ++i) {
+        const auto& u = samples_[i];
+        const float speed = minSpeed_ + u[1] * (maxSpeed_ - minSpeed_);
+        
+        Particle& particle = particles[i];
+        particle.position = position_ + positions_[i];
+        particle.velocity = directions_[i] * speed;
+        particle.force = glm::vec2(0.0f, 0.0f);
+        particle.lifetime = minLifetime_ + u[2] * (maxLifetime_ - minLifetime_);
+        particle.alive = true;
+    }
+}
+
+} // namespace particlesystem
@@ -0,0 +1,71 @@
+#include <particlesystem/spawn_queue.h>
+#include <algorithm>
+#include <utility>
+
+namespace particlesystem {
+
+SpawnQueue::SpawnQueue()
+    : head_(nullptr) {
+}
+
+SpawnQueue::~SpawnQueue() {
+    Batch* batch = head_.exchange(nullptr, std::memory_order_acquire);
+    while (batch) {
+        Batch* next = batch->next;
+        delete batch;
+        batch = next;
+    }
+}
+
+void SpawnQueue::submit(std::vector<Particle> particles) {
+    if (particles.empty()) {
+        return;
+    }
+    
+    Batch* batch = new Batch{std::move(particles), head_.load(std::memory_order_relaxed)};
+    
+    // Push the batch onto the list, retrying if another thread got there first
+    while (!head_.compare_exchange_weak(batch->next, batch, std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+}
+
+void SpawnQueue::push(const Particle& particle) {
+    submit(std::vector<Particle>(1, particle));
+}
+
+size_t SpawnQueue::drain(std::vector<Particle>& particles) {
+    // Take the whole list at once, producers continue on a fresh list
+    Batch* batch = head_.exchange(nullptr, std::memory_order_acquire);
+    
+    // The list is newest first, reverse it to keep the submission order
+    Batch* ordered = nullptr;
+    size_t count = 0;
+    while (batch) {
+        Batch* next = batch->next;
+        batch->next = ordered;
+        ordered = batch;
+        count += batch->particles.size();
+        batch = next;
+    }
+    
+    // One bulk append for all batches, growing geometrically so repeated drains stay cheap
+    const size_t required = particles.size() + count;
+    if (required > particles.capacity()) {
+        particles.reserve(std::max(required, 2 * particles.capacity()));
+    }
+    while (ordered) {
+        Batch* next = ordered->next;
+        particles.insert(particles.end(), ordered->particles.begin(), ordered->particles.end());
+        delete ordered;
+        ordered = next;
+    }
+    
+    return count;
+}
+
+bool SpawnQueue::empty() const {
+    return head_.load(std::memory_order_relaxed) == nullptr;
+}
+
+} // namespace particlesystem
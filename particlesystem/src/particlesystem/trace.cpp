@@ -0,0 +1,257 @@
+#include <particlesystem/trace.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace particlesystem::trace {
+
+namespace {
+
+// Name used for frame markers, recognised when writing
+constexpr const char* frameMarker = "Frame";
+
+struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> begin{0};
+    std::atomic<uint64_t> end{0};
+    std::atomic<uint32_t> thread{0};
+};
+
+// Ring of events written by one thread and read by write(). Slots are atomics, so reading
+// while the owner keeps writing is safe; events overwritten during a read are discarded.
+// Only the owner changes written, start() drops earlier events by moving startIndex.
+struct ThreadBuffer {
+    static constexpr size_t capacity = size_t{1} << 16;
+    std::array<Event, capacity> events;
+    std::atomic<uint64_t> written{0};
+    uint64_t startIndex = 0;  // Guarded by Registry::mutex
+    bool inUse = false;       // Guarded by Registry::mutex
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::map<uint32_t, std::string> threadNames;
+    std::atomic<uint32_t> nextThread{1};
+
+    std::string path;
+    size_t framesLeft = 0;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Gives a buffer to a thread for its lifetime. Buffers of finished threads are handed to
+// new ones, so short-lived workers do not grow the registry.
+struct ThreadState {
+    ThreadBuffer* buffer = nullptr;
+    uint32_t thread = 0;
+
+    ThreadState() : thread(registry().nextThread.fetch_add(1)) {}
+    ~ThreadState() {
+        if (buffer) {
+            std::lock_guard lock{registry().mutex};
+            buffer->inUse = false;
+        }
+    }
+
+    ThreadBuffer& acquire() {
+        if (!buffer) {
+            Registry& r = registry();
+            std::lock_guard lock{r.mutex};
+            const auto free = std::find_if(r.buffers.begin(), r.buffers.end(),
+                                           [](const auto& b) { return !b->inUse; });
+            if (free != r.buffers.end()) {
+                buffer = free->get();
+            } else {
+                r.buffers.push_back(std::make_unique<ThreadBuffer>());
+                buffer = r.buffers.back().get();
+            }
+            buffer->inUse = true;
+        }
+        return *buffer;
+    }
+};
+
+thread_local ThreadState threadState;
+
+struct Copy {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t thread;
+};
+
+// Escapes quotes, backslashes and control characters for a JSON string
+std::string escapeJson(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}  // namespace
+
+namespace detail {
+
+std::atomic<bool> recording{false};
+
+uint64_t now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch)
+            .count());
+}
+
+void record(const char* name, uint64_t begin, uint64_t end) {
+    ThreadBuffer& buffer = threadState.acquire();
+    const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    Event& event = buffer.events[index % ThreadBuffer::capacity];
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    event.thread.store(threadState.thread, std::memory_order_relaxed);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+void start(std::string path, size_t frames) {
+    Registry& r = registry();
+    {
+        std::lock_guard lock{r.mutex};
+        for (auto& buffer : r.buffers) {
+            buffer->startIndex = buffer->written.load(std::memory_order_acquire);
+        }
+        r.path = std::move(path);
+        r.framesLeft = r.path.empty() ? 0 : frames;
+    }
+    detail::now();  // Start the clock
+    detail::recording.store(true, std::memory_order_relaxed);
+}
+
+void stop() { detail::recording.store(false, std::memory_order_relaxed); }
+
+void frame() {
+    if (!active()) {
+        return;
+    }
+    const uint64_t time = detail::now();
+    detail::record(frameMarker, time, time);
+
+    Registry& r = registry();
+    std::string path;
+    {
+        std::lock_guard lock{r.mutex};
+        if (r.framesLeft == 0 || --r.framesLeft > 0) {
+            return;
+        }
+        path = r.path;
+    }
+    stop();
+    // Called from render loops, a trace that cannot be written must not end the program
+    try {
+        write(path);
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "{}\n", e.what());
+    }
+}
+
+void setThreadName(std::string_view name) {
+    Registry& r = registry();
+    std::lock_guard lock{r.mutex};
+    r.threadNames[threadState.thread] = std::string(name);
+}
+
+void write(const std::string& path) {
+    Registry& r = registry();
+    std::vector<Copy> events;
+    std::map<uint32_t, std::string> names;
+    {
+        std::lock_guard lock{r.mutex};
+        names = r.threadNames;
+        for (const auto& buffer : r.buffers) {
+            const uint64_t end = buffer->written.load(std::memory_order_acquire);
+            const uint64_t first = std::max(
+                buffer->startIndex, end > ThreadBuffer::capacity ? end - ThreadBuffer::capacity : 0);
+            const size_t start = events.size();
+            for (uint64_t i = first; i < end; ++i) {
+                const Event& e = buffer->events[i % ThreadBuffer::capacity];
+                events.push_back({e.name.load(std::memory_order_relaxed),
+                                  e.begin.load(std::memory_order_relaxed),
+                                  e.end.load(std::memory_order_relaxed),
+                                  e.thread.load(std::memory_order_relaxed)});
+            }
+
+            // Drop events the owner may have overwritten while they were copied. The owner
+            // writes event after into its slot before counting it, so that slot is stale too
+            const uint64_t after = buffer->written.load(std::memory_order_acquire);
+            if (after + 1 > ThreadBuffer::capacity + first) {
+                const size_t stale = std::min<uint64_t>(after + 1 - ThreadBuffer::capacity - first,
+                                                        end - first);
+                events.erase(events.begin() + static_cast<std::ptrdiff_t>(start),
+                             events.begin() + static_cast<std::ptrdiff_t>(start + stale));
+            }
+        }
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error(fmt::format("Unable to write trace to {}", path));
+    }
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    const auto separator = [&first]() {
+        const char* s = first ? "" : ",\n";
+        first = false;
+        return s;
+    };
+    for (const auto& [thread, name] : names) {
+        file << separator()
+             << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},"
+                            "\"args\":{{\"name\":\"{}\"}}}}",
+                            thread, escapeJson(name));
+    }
+    for (const Copy& e : events) {
+        if (!e.name) {
+            continue;
+        }
+        if (e.name == frameMarker) {
+            file << separator()
+                 << fmt::format("{{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,"
+                                "\"tid\":{},\"ts\":{:.3f}}}",
+                                e.thread, static_cast<double>(e.begin) / 1000.0);
+            continue;
+        }
+        file << separator()
+             << fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},"
+                            "\"dur\":{:.3f}}}",
+                            escapeJson(e.name), e.thread, static_cast<double>(e.begin) / 1000.0,
+                            static_cast<double>(e.end - e.begin) / 1000.0);
+    }
+    file << "\n]}\n";
+}
+
+} // namespace particlesystem::trace
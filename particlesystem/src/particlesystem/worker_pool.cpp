@@ -0,0 +1,114 @@
+#include <particlesystem/worker_pool.h>
+#include <particlesystem/trace.h>
+#include <algorithm>
+#include <string>
+
+namespace particlesystem {
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : generation_(0)
+    , pending_(0)
+    , stopping_(false)
+    , context_(nullptr)
+    , call_(nullptr)
+    , count_(0)
+    , participants_(1) {
+    start(threadCount);
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::setThreadCount(size_t count) {
+    count = std::max<size_t>(count, 1);
+    if (count == threadCount()) {
+        return;
+    }
+    stop();
+    start(count);
+}
+
+size_t WorkerPool::threadCount() const {
+    return threads_.size() + 1;
+}
+
+void WorkerPool::start(size_t count) {
+    stopping_ = false;
+    threads_.reserve(count - 1);
+    for (size_t t = 1; t < std::max<size_t>(count, 1); ++t) {
+        // Threads only take loops dispatched after this point, even if they start late
+        threads_.emplace_back([this, t, seen = generation_]() { work(t, seen); });
+    }
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    workAvailable_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+void WorkerPool::dispatch(size_t count, void* context, Call call) {
+    const size_t participants = std::min(threadCount(), count);
+    if (participants <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            call(context, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock{mutex_};
+        context_ = context;
+        call_ = call;
+        count_ = count;
+        participants_ = participants;
+        pending_ = participants - 1;
+        ++generation_;
+    }
+    workAvailable_.notify_all();
+
+    runShare(0);
+
+    std::unique_lock lock{mutex_};
+    workDone_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void WorkerPool::runShare(size_t t) {
+    for (size_t i = t; i < count_; i += participants_) {
+        call_(context_, i);
+    }
+}
+
+void WorkerPool::work(size_t t, size_t seen) {
+    trace::setThreadName("Worker " + std::to_string(t));
+    std::unique_lock lock{mutex_};
+    while (true) {
+        workAvailable_.wait(lock, [this, seen]() { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = generation_;
+        if (t >= participants_) {
+            continue;  // Fewer indices than threads, this thread is not needed
+        }
+
+        lock.unlock();
+        {
+            PS_TRACE_SCOPE("WorkerPool::work");
+            runShare(t);
+        }
+        lock.lock();
+        if (--pending_ == 0) {
+            workDone_.notify_one();
+        }
+    }
+}
+
+} // namespace particlesystem
@@ -0,0 +1,167 @@
+#include <rendering/density_grid.h>
+#include <particlesystem/trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t offscreen = std::numeric_limits<uint32_t>::max();
+
+}  // namespace
+
+namespace rendering {
+
+DensityGrid::DensityGrid(int width, int height)
+    : width_{0}, height_{0}, workers_{std::max(1u, std::thread::hardware_concurrency())} {
+    resize(width, height);
+}
+
+void DensityGrid::resize(int width, int height) {
+    width_ = std::max(width, 0);
+    height_ = std::max(height, 0);
+    const size_t size = static_cast<size_t>(width_) * static_cast<size_t>(height_);
+    count_.assign(size, 0);
+    weight_.assign(size, 0.0f);
+    red_.assign(size, 0.0f);
+    green_.assign(size, 0.0f);
+    blue_.assign(size, 0.0f);
+}
+
+int DensityGrid::width() const { return width_; }
+
+int DensityGrid::height() const { return height_; }
+
+void DensityGrid::setThreadCount(size_t count) { workers_.setThreadCount(count); }
+
+size_t DensityGrid::threadCount() const { return workers_.threadCount(); }
+
+size_t DensityGrid::memoryBytes() const {
+    return (weight_.capacity() + red_.capacity() + green_.capacity() + blue_.capacity()) *
+               sizeof(float) +
+           (count_.capacity() + cells_.capacity() + order_.capacity()) * sizeof(uint32_t) +
+           (bandOffsets_.capacity() + bandStarts_.capacity()) * sizeof(size_t);
+}
+
+void DensityGrid::bin(std::span<const glm::vec2> positions, std::span<const glm::vec4> colors,
+                      const Camera2D& camera) {
+    PS_TRACE_SCOPE("DensityGrid::bin");
+    const size_t count = std::min(positions.size(), colors.size());
+    const size_t rows = static_cast<size_t>(height_);
+    const size_t columns = static_cast<size_t>(width_);
+    const size_t maxThreads = std::min(workers_.threadCount(), std::max<size_t>(rows, 1));
+    const size_t threads = std::clamp<size_t>(count / 16384, 1, maxThreads);
+    cells_.resize(count);
+    order_.resize(count);
+    bandOffsets_.assign(threads * threads, 0);
+    bandStarts_.resize(threads + 1);
+
+    // Every thread owns the band of rows [rows * b / threads, rows * (b + 1) / threads)
+    const auto bandOf = [rows, threads](size_t row) { return ((row + 1) * threads - 1) / rows; };
+
+    // Pass 1: find the pixel of every particle and count the particles of every band, in
+    // parallel over contiguous ranges of particles
+    const float w = static_cast<float>(width_);
+    const float h = static_cast<float>(height_);
+    workers_.parallelFor(threads, [&](size_t t) {
+        size_t* counts = &bandOffsets_[t * threads];
+        const size_t begin = count * t / threads;
+        const size_t end = count * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec2 p = camera.toScreen(positions[i]);
+            const float x = std::floor((p.x + 1.0f) * 0.5f * w);
+            const float y = std::floor((1.0f - p.y) * 0.5f * h);
+            const bool inside = x >= 0.0f && x < w && y >= 0.0f && y < h;
+            cells_[i] = inside ? static_cast<uint32_t>(y * w + x) : offscreen;
+            if (inside) {
+                ++counts[bandOf(static_cast<size_t>(y))];
+            }
+        }
+    });
+
+    // Band b of the particles of thread t starts after all particles of earlier bands and
+    // those of band b from earlier threads, so every band lists its particles in order
+    size_t offset = 0;
+    for (size_t b = 0; b < threads; ++b) {
+        bandStarts_[b] = offset;
+        for (size_t t = 0; t < threads; ++t) {
+            const size_t n = bandOffsets_[t * threads + b];
+            bandOffsets_[t * threads + b] = offset;
+            offset += n;
+        }
+    }
+    bandStarts_[threads] = offset;
+
+    // Pass 2: sort the particles on screen into the lists of their bands
+    workers_.parallelFor(threads, [&](size_t t) {
+        size_t* next = &bandOffsets_[t * threads];
+        const size_t begin = count * t / threads;
+        const size_t end = count * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t cell = cells_[i];
+            if (cell != offscreen) {
+                order_[next[bandOf(cell / columns)]++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    // Pass 3: every thread accumulates the particles in its band, which needs no atomics or
+    // per thread copies of the grid
+    workers_.parallelFor(threads, [&](size_t b) {
+        const size_t first = rows * b / threads * columns;
+        const size_t last = rows * (b + 1) / threads * columns;
+        std::fill(count_.begin() + static_cast<std::ptrdiff_t>(first),
+                  count_.begin() + static_cast<std::ptrdiff_t>(last), 0u);
+        std::fill(weight_.begin() + static_cast<std::ptrdiff_t>(first),
+                  weight_.begin() + static_cast<std::ptrdiff_t>(last), 0.0f);
+        std::fill(red_.begin() + static_cast<std::ptrdiff_t>(first),
+                  red_.begin() + static_cast<std::ptrdiff_t>(last), 0.0f);
+        std::fill(green_.begin() + static_cast<std::ptrdiff_t>(first),
+                  green_.begin() + static_cast<std::ptrdiff_t>(last), 0.0f);
+        std::fill(blue_.begin() + static_cast<std::ptrdiff_t>(first),
+                  blue_.begin() + static_cast<std::ptrdiff_t>(last), 0.0f);
+
+        for (size_t k = bandStarts_[b]; k < bandStarts_[b + 1]; ++k) {
+            const uint32_t i = order_[k];
+            const uint32_t cell = cells_[i];
+            const glm::vec4& color = colors[i];
+            ++count_[cell];
+            weight_[cell] += color.a;
+            red_[cell] += color.r * color.a;
+            green_[cell] += color.g * color.a;
+            blue_[cell] += color.b * color.a;
+        }
+    });
+}
+
+uint32_t DensityGrid::count(int x, int y) const {
+    return count_[static_cast<size_t>(y * width_ + x)];
+}
+
+float DensityGrid::weight(int x, int y) const {
+    return weight_[static_cast<size_t>(y * width_ + x)];
+}
+
+glm::vec3 DensityGrid::meanColor(int x, int y) const {
+    const size_t cell = static_cast<size_t>(y * width_ + x);
+    const float weight = weight_[cell];
+    if (weight <= 0.0f) {
+        return glm::vec3(0.0f, 0.0f, 0.0f);
+    }
+    return glm::vec3(red_[cell], green_[cell], blue_[cell]) * (1.0f / weight);
+}
+
+void DensityGrid::toneMap(std::span<uint8_t> rgba, float exposure) const {
+    for (size_t cell = 0; cell < weight_.size(); ++cell) {
+        const float weight = weight_[cell];
+        const float inverse = weight > 0.0f ? 1.0f / weight : 0.0f;
+        rgba[4 * cell + 0] = toByte(red_[cell] * inverse);
+        rgba[4 * cell + 1] = toByte(green_[cell] * inverse);
+        rgba[4 * cell + 2] = toByte(blue_[cell] * inverse);
+        rgba[4 * cell + 3] = toByte(1.0f - std::exp(-exposure * weight));
+    }
+}
+
+}  // namespace rendering
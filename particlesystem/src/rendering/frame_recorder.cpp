@@ -0,0 +1,269 @@
+#include <rendering/frame_recorder.h>
+#include <particlesystem/trace.h>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace {
+
+std::ofstream openFile(const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(fmt::format("Unable to write frame to {}", path));
+    }
+    return file;
+}
+
+// Flushes and closes a frame file. Short writes, e.g. on a full disk, only show up as a
+// failed stream, so they are turned into errors here.
+void closeFile(std::ofstream& file, const std::string& path) {
+    file.close();
+    if (!file) {
+        throw std::runtime_error(fmt::format("Unable to write frame to {}", path));
+    }
+}
+
+// CRC-32 as used by PNG chunks
+uint32_t crc32(uint32_t crc, std::span<const uint8_t> data) {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (uint8_t byte : data) {
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeChunk(std::ofstream& file, const char* type, std::span<const uint8_t> data) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    const uint32_t crc = crc32(0, std::span(chunk).subspan(4));
+    appendBigEndian(chunk, crc);
+    file.write(reinterpret_cast<const char*>(chunk.data()),
+               static_cast<std::streamsize>(chunk.size()));
+}
+
+}  // namespace
+
+namespace rendering {
+
+void writePpm(const std::string& path, int width, int height, std::span<const uint8_t> rgba) {
+    std::ofstream file = openFile(path);
+    file << "P6\n" << width << ' ' << height << "\n255\n";
+
+    std::vector<char> row(static_cast<size_t>(width) * 3);
+    for (size_t y = 0; y < static_cast<size_t>(height); ++y) {
+        const uint8_t* src = rgba.data() + y * static_cast<size_t>(width) * 4;
+        for (size_t x = 0; x < static_cast<size_t>(width); ++x) {
+            row[3 * x + 0] = static_cast<char>(src[4 * x + 0]);
+            row[3 * x + 1] = static_cast<char>(src[4 * x + 1]);
+            row[3 * x + 2] = static_cast<char>(src[4 * x + 2]);
+        }
+        file.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+    closeFile(file, path);
+}
+
+void writePng(const std::string& path, int width, int height, std::span<const uint8_t> rgba) {
+    std::ofstream file = openFile(path);
+    constexpr std::array<uint8_t, 8> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature.data()), signature.size());
+
+    // 8 bits per channel RGBA, no interlacing
+    std::vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    writeChunk(file, "IHDR", header);
+
+    // Every row starts with filter type 0 (none). The zlib stream stores this data in
+    // uncompressed deflate blocks of at most 65535 bytes, which costs little more than a copy.
+    const size_t rowSize = static_cast<size_t>(width) * 4 + 1;
+    const size_t rawSize = rowSize * static_cast<size_t>(height);
+    constexpr size_t maxBlock = 65535;
+    std::vector<uint8_t> data;
+    data.reserve(rawSize + (rawSize / maxBlock + 1) * 5 + 6);
+    data.push_back(0x78);
+    data.push_back(0x01);
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+    size_t blockLeft = 0;
+    size_t remaining = rawSize;
+    const auto put = [&](uint8_t byte) {
+        if (blockLeft == 0) {
+            const size_t size = std::min(remaining, maxBlock);
+            data.push_back(remaining == size ? 1 : 0);  // Final block flag
+            data.push_back(static_cast<uint8_t>(size));
+            data.push_back(static_cast<uint8_t>(size >> 8));
+            data.push_back(static_cast<uint8_t>(~size));
+            data.push_back(static_cast<uint8_t>(~size >> 8));
+            blockLeft = size;
+        }
+        data.push_back(byte);
+        adlerA = (adlerA + byte) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+        --blockLeft;
+        --remaining;
+    };
+    for (size_t y = 0; y < static_cast<size_t>(height); ++y) {
+        put(0);
+        const uint8_t* src = rgba.data() + y * (rowSize - 1);
+        for (size_t i = 0; i + 1 < rowSize; ++i) {
+            put(src[i]);
+        }
+    }
+    appendBigEndian(data, (adlerB << 16) | adlerA);
+    writeChunk(file, "IDAT", data);
+    writeChunk(file, "IEND", {});
+    closeFile(file, path);
+}
+
+FrameRecorder::FrameRecorder(const RecordingOptions& options)
+    : options_{options}, stopping_{false} {
+    options_.queueSize = std::max<size_t>(options_.queueSize, 1);
+    writer_ = std::thread([this]() { run(); });
+}
+
+FrameRecorder::~FrameRecorder() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    workAvailable_.notify_one();
+    writer_.join();
+}
+
+std::vector<uint8_t> FrameRecorder::takeBuffer(size_t size) {
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard lock{mutex_};
+        if (!freeBuffers_.empty()) {
+            buffer = std::move(freeBuffers_.back());
+            freeBuffers_.pop_back();
+        }
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+bool FrameRecorder::submit(std::vector<uint8_t> rgba, int width, int height, size_t frame) {
+    {
+        std::unique_lock lock{mutex_};
+        ++stats_.captured;
+        if (queue_.size() >= options_.queueSize) {
+            if (options_.dropWhenFull) {
+                ++stats_.dropped;
+                freeBuffers_.push_back(std::move(rgba));
+                return false;
+            }
+            spaceAvailable_.wait(lock, [this]() { return queue_.size() < options_.queueSize; });
+        }
+        queue_.push_back({std::move(rgba), width, height, frame});
+        stats_.queueDepth = queue_.size();
+        stats_.maxQueueDepth = std::max(stats_.maxQueueDepth, queue_.size());
+    }
+    workAvailable_.notify_one();
+    return true;
+}
+
+void FrameRecorder::drop() {
+    std::lock_guard lock{mutex_};
+    ++stats_.captured;
+    ++stats_.dropped;
+}
+
+RecordingStats FrameRecorder::stats() const {
+    std::lock_guard lock{mutex_};
+    RecordingStats stats = stats_;
+    for (const Frame& frame : queue_) {
+        stats.bufferBytes += frame.rgba.capacity();
+    }
+    for (const auto& buffer : freeBuffers_) {
+        stats.bufferBytes += buffer.capacity();
+    }
+    return stats;
+}
+
+const RecordingOptions& FrameRecorder::options() const { return options_; }
+
+void FrameRecorder::run() {
+    particlesystem::trace::setThreadName("FrameRecorder");
+    std::unique_lock lock{mutex_};
+    while (true) {
+        workAvailable_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;  // Stopping and everything is written
+        }
+
+        Frame frame = std::move(queue_.front());
+        queue_.pop_front();
+        stats_.queueDepth = queue_.size();
+        lock.unlock();
+        spaceAvailable_.notify_one();
+
+        bool ok = true;
+        try {
+            write(frame);
+        } catch (const std::exception&) {
+            ok = false;
+        }
+
+        lock.lock();
+        if (ok) {
+            ++stats_.written;
+        } else {
+            ++stats_.failed;
+        }
+        freeBuffers_.push_back(std::move(frame.rgba));
+    }
+}
+
+void FrameRecorder::write(const Frame& frame) const {
+    PS_TRACE_SCOPE("FrameRecorder::write");
+    switch (options_.format) {
+        case FrameFormat::Raw: {
+            const std::string path = fmt::format("{}{:05}_{}x{}.raw", options_.prefix, frame.number,
+                                                 frame.width, frame.height);
+            std::ofstream file = openFile(path);
+            file.write(reinterpret_cast<const char*>(frame.rgba.data()),
+                       static_cast<std::streamsize>(frame.rgba.size()));
+            closeFile(file, path);
+            break;
+        }
+        case FrameFormat::Ppm:
+            writePpm(fmt::format("{}{:05}.ppm", options_.prefix, frame.number), frame.width,
+                     frame.height, frame.rgba);
+            break;
+        case FrameFormat::Png:
+            writePng(fmt::format("{}{:05}.png", options_.prefix, frame.number), frame.width,
+                     frame.height, frame.rgba);
+            break;
+    }
+}
+
+}  // namespace rendering
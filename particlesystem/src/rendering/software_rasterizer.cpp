@@ -0,0 +1,240 @@
+#include <rendering/software_rasterizer.h>
+#include <particlesystem/trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+// A point in pixel coordinates with the y axis pointing down
+struct ScreenPoint {
+    float x;
+    float y;
+    float radius;  // Zero for points that cover a single pixel
+};
+
+ScreenPoint toScreen(const rendering::PointVertex& point, int width, int height) {
+    const float diameter = point.scale > 1.0f ? point.scale : 0.0f;
+    return {(point.position.x + 1.0f) * 0.5f * static_cast<float>(width),
+            (1.0f - point.position.y) * 0.5f * static_cast<float>(height), 0.5f * diameter};
+}
+
+}  // namespace
+
+namespace rendering {
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height)
+    : width_{0}, height_{0}, tilesX_{0}, tilesY_{0},
+      workers_{std::max(1u, std::thread::hardware_concurrency())} {
+    resize(width, height);
+}
+
+void SoftwareRasterizer::resize(int width, int height) {
+    width_ = std::max(width, 0);
+    height_ = std::max(height, 0);
+    tilesX_ = (width_ + tileSize - 1) / tileSize;
+    tilesY_ = (height_ + tileSize - 1) / tileSize;
+
+    constexpr size_t planeSize = static_cast<size_t>(tileSize) * tileSize;
+    tiles_.resize(static_cast<size_t>(tilesX_) * static_cast<size_t>(tilesY_));
+    for (int ty = 0; ty < tilesY_; ++ty) {
+        for (int tx = 0; tx < tilesX_; ++tx) {
+            Tile& tile = tiles_[static_cast<size_t>(ty * tilesX_ + tx)];
+            tile.x0 = tx * tileSize;
+            tile.y0 = ty * tileSize;
+            tile.x1 = std::min(tile.x0 + tileSize, width_);
+            tile.y1 = std::min(tile.y0 + tileSize, height_);
+            tile.r.resize(planeSize);
+            tile.g.resize(planeSize);
+            tile.b.resize(planeSize);
+            tile.a.resize(planeSize);
+        }
+    }
+}
+
+int SoftwareRasterizer::width() const { return width_; }
+
+int SoftwareRasterizer::height() const { return height_; }
+
+void SoftwareRasterizer::setThreadCount(size_t count) { workers_.setThreadCount(count); }
+
+size_t SoftwareRasterizer::threadCount() const { return workers_.threadCount(); }
+
+size_t SoftwareRasterizer::memoryBytes() const {
+    size_t bytes = tiles_.capacity() * sizeof(Tile);
+    for (const Tile& tile : tiles_) {
+        bytes += (tile.r.capacity() + tile.g.capacity() + tile.b.capacity() + tile.a.capacity()) *
+                 sizeof(float);
+    }
+    for (const auto& threadBins : bins_) {
+        bytes += threadBins.capacity() * sizeof(std::vector<uint32_t>);
+        for (const auto& bin : threadBins) {
+            bytes += bin.capacity() * sizeof(uint32_t);
+        }
+    }
+    return bytes;
+}
+
+void SoftwareRasterizer::clear(glm::vec4 color) {
+    for (Tile& tile : tiles_) {
+        std::fill(tile.r.begin(), tile.r.end(), color.r);
+        std::fill(tile.g.begin(), tile.g.end(), color.g);
+        std::fill(tile.b.begin(), tile.b.end(), color.b);
+        std::fill(tile.a.begin(), tile.a.end(), color.a);
+    }
+}
+
+void SoftwareRasterizer::drawPoints(std::span<const PointVertex> points) {
+    PS_TRACE_SCOPE("SoftwareRasterizer::drawPoints");
+    if (points.empty() || tiles_.empty()) {
+        return;
+    }
+    const size_t threads =
+        std::min(workers_.threadCount(), std::max<size_t>(points.size() / minPointsPerThread, 1));
+
+    // Bin the points, each thread takes a contiguous range so that concatenating the bins
+    // of all threads keeps the submission order
+    bins_.resize(threads);
+    workers_.parallelFor(threads, [&](size_t t) {
+        auto& bins = bins_[t];
+        bins.resize(tiles_.size());
+        for (auto& bin : bins) {
+            bin.clear();
+        }
+
+        const size_t begin = points.size() * t / threads;
+        const size_t end = points.size() * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i) {
+            const ScreenPoint p = toScreen(points[i], width_, height_);
+            const float extent = p.radius > 0.0f ? p.radius : 0.0f;
+            const int x0 = std::max(static_cast<int>(std::floor(p.x - extent)), 0);
+            const int x1 = std::min(static_cast<int>(std::floor(p.x + extent)), width_ - 1);
+            const int y0 = std::max(static_cast<int>(std::floor(p.y - extent)), 0);
+            const int y1 = std::min(static_cast<int>(std::floor(p.y + extent)), height_ - 1);
+            if (x0 > x1 || y0 > y1) {
+                continue;
+            }
+            for (int ty = y0 / tileSize; ty <= y1 / tileSize; ++ty) {
+                for (int tx = x0 / tileSize; tx <= x1 / tileSize; ++tx) {
+                    bins[static_cast<size_t>(ty * tilesX_ + tx)].push_back(
+                        static_cast<uint32_t>(i));
+                }
+            }
+        }
+    });
+
+    // Rasterize the tiles in parallel, they do not share any pixels
+    std::atomic<size_t> nextTile{0};
+    workers_.parallelFor(std::min(workers_.threadCount(), tiles_.size()), [&](size_t) {
+        for (size_t i = nextTile++; i < tiles_.size(); i = nextTile++) {
+            for (const auto& bins : bins_) {
+                rasterize(tiles_[i], points, bins[i]);
+            }
+        }
+    });
+}
+
+void SoftwareRasterizer::rasterize(Tile& tile, std::span<const PointVertex> points,
+                                   std::span<const uint32_t> indices) const {
+    for (uint32_t index : indices) {
+        const PointVertex& point = points[index];
+        const ScreenPoint p = toScreen(point, width_, height_);
+
+        const float cr = static_cast<float>(point.color & 0xFF) / 255.0f;
+        const float cg = static_cast<float>((point.color >> 8) & 0xFF) / 255.0f;
+        const float cb = static_cast<float>((point.color >> 16) & 0xFF) / 255.0f;
+        const float ca = static_cast<float>(point.color >> 24) / 255.0f;
+
+        // Rows whose pixel centers can be inside the circle
+        int y0, y1;
+        if (p.radius > 0.0f) {
+            y0 = static_cast<int>(std::ceil(p.y - p.radius - 0.5f));
+            y1 = static_cast<int>(std::floor(p.y + p.radius - 0.5f));
+        } else {
+            y0 = y1 = static_cast<int>(std::floor(p.y));
+        }
+        y0 = std::max(y0, tile.y0);
+        y1 = std::min(y1, tile.y1 - 1);
+
+        for (int y = y0; y <= y1; ++y) {
+            // Each row of a circle is a single span of pixels, found analytically
+            int x0, x1;
+            if (p.radius > 0.0f) {
+                const float dy = static_cast<float>(y) + 0.5f - p.y;
+                const float halfWidth2 = p.radius * p.radius - dy * dy;
+                if (halfWidth2 < 0.0f) {
+                    continue;
+                }
+                const float halfWidth = std::sqrt(halfWidth2);
+                x0 = static_cast<int>(std::ceil(p.x - halfWidth - 0.5f));
+                x1 = static_cast<int>(std::floor(p.x + halfWidth - 0.5f));
+            } else {
+                x0 = x1 = static_cast<int>(std::floor(p.x));
+            }
+            x0 = std::max(x0, tile.x0);
+            x1 = std::min(x1, tile.x1 - 1);
+            if (x0 > x1) {
+                continue;
+            }
+
+            // Blend the span, a straight loop over the planes that vectorizes
+            const size_t offset = static_cast<size_t>((y - tile.y0) * tileSize + (x0 - tile.x0));
+            const size_t count = static_cast<size_t>(x1 - x0 + 1);
+            float* r = tile.r.data() + offset;
+            float* g = tile.g.data() + offset;
+            float* b = tile.b.data() + offset;
+            float* a = tile.a.data() + offset;
+            for (size_t x = 0; x < count; ++x) {
+                r[x] += (cr - r[x]) * ca;
+                g[x] += (cg - g[x]) * ca;
+                b[x] += (cb - b[x]) * ca;
+                a[x] += (ca - a[x]) * ca;
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::drawImage(std::span<const uint8_t> rgba) {
+    constexpr float scale = 1.0f / 255.0f;
+    for (Tile& tile : tiles_) {
+        for (int y = tile.y0; y < tile.y1; ++y) {
+            for (int x = tile.x0; x < tile.x1; ++x) {
+                const size_t dst = static_cast<size_t>((y - tile.y0) * tileSize + (x - tile.x0));
+                const size_t src = (static_cast<size_t>(y) * static_cast<size_t>(width_) +
+                                    static_cast<size_t>(x)) * 4;
+                const float alpha = rgba[src + 3] * scale;
+                const float keep = 1.0f - alpha;
+                tile.r[dst] = rgba[src + 0] * scale * alpha + tile.r[dst] * keep;
+                tile.g[dst] = rgba[src + 1] * scale * alpha + tile.g[dst] * keep;
+                tile.b[dst] = rgba[src + 2] * scale * alpha + tile.b[dst] * keep;
+                tile.a[dst] = alpha * alpha + tile.a[dst] * keep;
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::readPixels(std::span<uint8_t> rgba) const {
+    for (const Tile& tile : tiles_) {
+        for (int y = tile.y0; y < tile.y1; ++y) {
+            for (int x = tile.x0; x < tile.x1; ++x) {
+                const size_t src = static_cast<size_t>((y - tile.y0) * tileSize + (x - tile.x0));
+                const size_t dst = (static_cast<size_t>(y) * static_cast<size_t>(width_) +
+                                    static_cast<size_t>(x)) * 4;
+                rgba[dst + 0] = toByte(tile.r[src]);
+                rgba[dst + 1] = toByte(tile.g[src]);
+                rgba[dst + 2] = toByte(tile.b[src]);
+                rgba[dst + 3] = toByte(tile.a[src]);
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> SoftwareRasterizer::readPixels() const {
+    std::vector<uint8_t> rgba(static_cast<size_t>(width_) * static_cast<size_t>(height_) * 4);
+    readPixels(rgba);
+    return rgba;
+}
+
+}  // namespace rendering
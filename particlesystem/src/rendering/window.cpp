@@ -1,8 +1,16 @@
 #include <rendering/window.h>
+#include <rendering/software_rasterizer.h>
+#include <rendering/density_grid.h>
+#include <rendering/frame_recorder.h>
+#include <particlesystem/trace.h>
+#include <particlesystem/worker_pool.h>
 
 #include <array>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <thread>
 #include <vector>
 #include <algorithm>
 
@@ -14,7 +22,6 @@
 #include <fmt/format.h>
 
 #include <glm/common.hpp>
-#include <glm/packing.hpp>
 
 // Dear students;
 // if you have found your way here, rest assured that understanding the rest of this file
@@ -26,6 +33,23 @@
 
 constexpr size_t VBO_CAP = 1024 * 1024;
 
+// Number of VBO_CAP sized regions in the persistently mapped vertex buffer. A region is
+// only written again once the GPU has finished the draw that read it
+constexpr size_t VBO_REGIONS = 3;
+
+// Smallest number of points a PointWriter chunk is worth handing to another thread for
+constexpr size_t MIN_CHUNK_POINTS = 4096;
+
+// Buffer storage is core in OpenGL 4.4, but the context is only guaranteed to be 3.3
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+using BufferStorageProc = void(APIENTRY*)(GLenum target, GLsizeiptr size, const void* data,
+                                          GLbitfield flags);
+
 // Copy string_views into a zero terminated stack based string which is compatible with
 // ImGui and other libraries that expect zero terminated strings
 struct CStr {
@@ -53,14 +77,91 @@ private:
 
 // Internal definition of window implementation
 struct rendering::Window::Impl {
-    Impl(std::string_view title, int width, int height);
+    Impl(std::string_view title, int width, int height, const WindowOptions& options);
     ~Impl();
 
     GLFWwindow* window;
 
+    // Headless windows render into this framebuffer instead of a visible window
+    bool headless;
+    int headlessWidth;
+    int headlessHeight;
+    GLuint fbo = 0;
+    GLuint colorBuffer = 0;
+
+    // Frame recording. Frames are read into pixel pack buffers without waiting and handed
+    // to the recorder once their fence has passed, usually a frame or two later
+    struct Readback {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        size_t frame = 0;
+        int width = 0;
+        int height = 0;
+    };
+    std::unique_ptr<rendering::FrameRecorder> recorder;
+    std::array<Readback, 3> readbacks;
+    size_t frameNumber = 0;
+    void captureFrame();
+    void collectReadbacks(bool wait);
+    void stopRecording();
+
+    // Points are drawn on the CPU when the software rasterizer is used. Its image is shown
+    // with a textured triangle covering the screen
+    std::unique_ptr<rendering::SoftwareRasterizer> rasterizer;
+    std::vector<rendering::PointVertex> cpuPoints;
+    std::vector<uint8_t> image;
+    GLuint imageProgram = 0;
+    GLuint imageVao = 0;
+    GLuint imageTexture = 0;
+    void createImageObjects();
+    void presentImage();
+
+    // Draws an 8-bit RGBA image, top row first, stretched over the whole screen
+    void drawImage(std::span<const uint8_t> rgba, int w, int h, bool blend);
+
+    // Particles drawn with drawDensity are binned into this grid, created on first use
+    std::unique_ptr<rendering::DensityGrid> density;
+    std::vector<uint8_t> densityImage;
+
+    // Size of the framebuffer that is drawn to
+    glm::ivec2 framebufferSize() const;
+
+    // Largest memory total seen at the end of a frame
+    size_t peakMemory = 0;
+
+    // Reads the framebuffer as 8-bit RGBA values, top row first
+    std::vector<uint8_t> readFramebuffer();
+
     GLuint program;
     GLuint vao;
     GLuint vbo;
+
+    // Camera of the queued points, a uniform of the point program
+    Camera2D camera;
+    GLint cameraCenterLocation = -1;
+    GLint cameraZoomLocation = -1;
+    
+    // Points are queued in the mapped buffer during the frame and drawn all at once by
+    // flushPoints, at the latest in endFrame
+    rendering::PointVertex* openPoints();
+    void flushPoints();
+
+    // Returns space for up to maxCount points at the end of the queue, at least one point
+    // as long as maxCount > 0. Commit the space with endPoints.
+    std::span<rendering::PointVertex> reservePoints(size_t maxCount);
+
+    // Persistent mapping of all VBO_REGIONS regions, or nullptr when the buffer is orphaned
+    // and mapped once per batch of queued points instead
+    rendering::PointVertex* persistent = nullptr;
+    size_t region = 0;
+    std::array<GLsync, VBO_REGIONS> fences{};
+
+    rendering::PointVertex* mapped = nullptr;  // Start of the queue, nullptr if nothing is queued
+    size_t queued = 0;                         // Points written to the queue so far
+    size_t reserved = 0;                       // Points handed out by the last beginPoints
+
+    // Threads writing the chunks of drawPoints with a PointWriter, kept between calls
+    particlesystem::WorkerPool writers;
     
     // Add tracking for delta time and FPS
     double lastFrameTime = 0.0;
@@ -73,11 +174,7 @@ struct rendering::Window::Impl {
 namespace {
 
 // This structure represents how the points is stored in the vertex buffer
-struct Point {
-    glm::vec2 position;
-    float scale;
-    uint32_t color_packed;
-};
+using Point = rendering::PointVertex;
 
 /**
  * Checks the compilation status of the shader passed into it and prints out a message in
@@ -179,67 +276,163 @@ static void debugCallbackGL(GLenum source, GLenum type, GLuint id, GLenum severi
 }
 */
 
+// Compiles and links a shader program from vertex and fragment shader sources
+static GLuint linkProgram(const char* vsSrc, const char* fsSrc, std::string_view name) {
+    GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vsSrc, nullptr);
+    glCompileShader(vertex);
+
+    GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fsSrc, nullptr);
+    glCompileShader(fragment);
+
+    GLuint program = 0;
+    if (checkShader(vertex, fmt::format("{}-vertex", name)) &&
+        checkShader(fragment, fmt::format("{}-fragment", name))) {
+        program = glCreateProgram();
+
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+
+        glLinkProgram(program);
+        checkProgram(program, fmt::format("{}-program", name));
+
+        glDetachShader(program, vertex);
+        glDetachShader(program, fragment);
+    }
+
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    return program;
+}
+
 // Creates the shader program for points.
+// Points larger than a pixel are round, matching the SoftwareRasterizer
 static GLuint createPointProgram() {
-    constexpr const char* vsSrc[1] = {R"(
+    constexpr const char* vsSrc = R"(
         #version 330
         layout(location = 0) in vec2  in_position;
         layout(location = 1) in float in_scale;
         layout(location = 2) in vec4  in_color;
 
+        uniform vec2 camera_center;
+        uniform float camera_zoom;
+
         out vec4 vs_color;
+        flat out float vs_scale;
 
         void main() {
             vs_color = in_color;
-            gl_PointSize = in_scale;
-            gl_Position = vec4(in_position, 0.0, 1.0);
+            vs_scale = in_scale * camera_zoom;
+            gl_PointSize = vs_scale;
+            gl_Position = vec4((in_position - camera_center) * camera_zoom, 0.0, 1.0);
         }
-    )"};
+    )";
 
-    constexpr const char* fsSrc[1] = {R"(
+    constexpr const char* fsSrc = R"(
         #version 330
         in vec4 vs_color;
+        flat in float vs_scale;
         out vec4 out_color;
 
         void main() {
+            if (vs_scale > 1.0 && length(gl_PointCoord - vec2(0.5)) > 0.5) {
+                discard;
+            }
             out_color = vec4(vs_color);
         }
-    )"};
+    )";
 
-    GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, vsSrc, nullptr);
-    glCompileShader(vertex);
+    return linkProgram(vsSrc, fsSrc, "point");
+}
 
-    GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, fsSrc, nullptr);
-    glCompileShader(fragment);
+// Creates the shader program that shows the image of the software rasterizer. It draws a
+// single triangle covering the screen, so no vertex data is needed
+static GLuint createImageProgram() {
+    constexpr const char* vsSrc = R"(
+        #version 330
+        out vec2 vs_uv;
 
-    GLuint program = 0;
-    if (checkShader(vertex, "point-vertex") && checkShader(fragment, "point-fragment")) {
-        program = glCreateProgram();
+        void main() {
+            vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+            vs_uv = vec2(p.x, 1.0 - p.y);  // The image is stored top row first
+            gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+        }
+    )";
 
-        glAttachShader(program, vertex);
-        glAttachShader(program, fragment);
+    constexpr const char* fsSrc = R"(
+        #version 330
+        uniform sampler2D image;
+        in vec2 vs_uv;
+        out vec4 out_color;
 
-        glLinkProgram(program);
-        checkProgram(program, "point-program");
+        void main() {
+            out_color = texture(image, vs_uv);
+        }
+    )";
 
-        glDetachShader(program, vertex);
-        glDetachShader(program, fragment);
+    return linkProgram(vsSrc, fsSrc, "image");
+}
+
+// Returns true if the current context supports the named extension
+static bool hasExtension(std::string_view name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension =
+            reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension && name == extension) {
+            return true;
+        }
     }
+    return false;
+}
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+// Looks up glBufferStorage if persistent mapping is supported and not disabled through the
+// options or the PARTICLESYSTEM_NO_PERSISTENT_MAP environment variable, returns nullptr
+// otherwise
+static BufferStorageProc loadBufferStorage(const rendering::WindowOptions& options) {
+    if (!options.persistentMapping || std::getenv("PARTICLESYSTEM_NO_PERSISTENT_MAP")) {
+        return nullptr;
+    }
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if ((major < 4 || (major == 4 && minor < 4)) && !hasExtension("GL_ARB_buffer_storage")) {
+        return nullptr;
+    }
+    return reinterpret_cast<BufferStorageProc>(glfwGetProcAddress("glBufferStorage"));
+}
 
-    return program;
+// Creates an invisible window with the first context creation API that works. A display
+// server provides a native context; without one only EGL or OSMesa are available.
+static GLFWwindow* createHeadlessWindow(int width, int height) {
+    for (int api : {GLFW_NATIVE_CONTEXT_API, GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API}) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+        GLFWwindow* window = glfwCreateWindow(width, height, "Particle System", nullptr, nullptr);
+        if (window) {
+            return window;
+        }
+    }
+    return nullptr;
 }
 
 }  // namespace
 
 namespace rendering {
 
-Window::Impl::Impl(std::string_view title, int width, int height)
-    : window{nullptr}, program{0}, vao{0}, vbo{0} {
+Window::Impl::Impl(std::string_view title, int width, int height, const WindowOptions& options)
+    : window{nullptr}, headless{options.headless}, headlessWidth{width}, headlessHeight{height},
+      program{0}, vao{0}, vbo{0} {
+
+#ifdef GLFW_PLATFORM_NULL
+    // Without a display server GLFW would fail to initialize, the null platform needs none
+    if (headless && glfwPlatformSupported(GLFW_PLATFORM_NULL)) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
 
     // Initialize GLFW for window handling
     if (glfwInit() != GLFW_TRUE) {
@@ -250,13 +443,43 @@ Window::Impl::Impl(std::string_view title, int width, int height)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    window = glfwCreateWindow(width, height, "Particle System", nullptr, nullptr);
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = createHeadlessWindow(width, height);
+    } else {
+        window = glfwCreateWindow(width, height, "Particle System", nullptr, nullptr);
+    }
+    if (!window) {
+        glfwTerminate();
+        throw std::runtime_error("Unable to create an OpenGL 3.3 context");
+    }
     glfwMakeContextCurrent(window);
     glfwSwapInterval(0);
 
     // Initialize the GLAD OpenGL wrapper
     gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
+    // The default framebuffer of an invisible window may not be backed by memory, so
+    // headless windows draw into their own framebuffer
+    if (headless) {
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                  colorBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            // The destructor does not run for a failed constructor, so clean up here
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            throw std::runtime_error("Unable to create the offscreen framebuffer");
+        }
+    }
+
     // Initialize ImGui UI library
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -272,12 +495,34 @@ Window::Impl::Impl(std::string_view title, int width, int height)
 
     // Create GL objects
     program = createPointProgram();
+    cameraCenterLocation = glGetUniformLocation(program, "camera_center");
+    cameraZoomLocation = glGetUniformLocation(program, "camera_zoom");
+    if (options.softwareRasterizer) {
+        rasterizer = std::make_unique<SoftwareRasterizer>(width, height);
+        createImageObjects();
+    }
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
-    // Allocate vertex buffer memory
+    // Allocate vertex buffer memory. Where possible the buffer is mapped once for its whole
+    // lifetime and split into regions that are fenced individually, so writing never waits
+    // for a draw that is still reading. Otherwise the buffer is orphaned on every draw.
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, VBO_CAP * sizeof(Point), nullptr, GL_DYNAMIC_DRAW);
+    if (BufferStorageProc bufferStorage = loadBufferStorage(options)) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = static_cast<GLsizeiptr>(VBO_REGIONS * VBO_CAP * sizeof(Point));
+        bufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        persistent = static_cast<Point*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (!persistent) {
+            // Immutable storage cannot be reallocated, the fallback needs a new buffer
+            glDeleteBuffers(1, &vbo);
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_ARRAY_BUFFER, VBO_CAP * sizeof(Point), nullptr, GL_STREAM_DRAW);
+    }
 
     // Setup vertex attribute pointers for Points
     glBindVertexArray(vao);
@@ -293,17 +538,41 @@ Window::Impl::Impl(std::string_view title, int width, int height)
 
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Point),
-                          reinterpret_cast<const void*>(offsetof(Point, color_packed)));
+                          reinterpret_cast<const void*>(offsetof(Point, color)));
 
     glBindVertexArray(0);
 
+    // Frame dumps keep every frame, the render loop waits for the writer if it falls behind
+    if (!options.frameDumpPrefix.empty()) {
+        recorder = std::make_unique<FrameRecorder>(
+            RecordingOptions{options.frameDumpPrefix, FrameFormat::Ppm, 8, false});
+    }
+
     checkOpenGLError("postInit");
 }
 
 Window::Impl::~Impl() {
+    stopRecording();
+    for (Readback& readback : readbacks) {
+        glDeleteBuffers(1, &readback.buffer);
+    }
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (persistent || (mapped && !rasterizer)) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
     glDeleteProgram(program);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteProgram(imageProgram);
+    glDeleteVertexArrays(1, &imageVao);
+    glDeleteTextures(1, &imageTexture);
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -315,8 +584,8 @@ Window::Impl::~Impl() {
     glfwTerminate();
 }
 
-Window::Window(std::string_view title, int width, int height)
-    : impl(std::make_unique<Impl>(title, width, height)) {}
+Window::Window(std::string_view title, int width, int height, const WindowOptions& options)
+    : impl(std::make_unique<Impl>(title, width, height, options)) {}
 
 Window::~Window() {}
 
@@ -327,6 +596,9 @@ double Window::time() const { return glfwGetTime(); }
 bool Window::shouldClose() const { return glfwWindowShouldClose(impl->window); }
 
 void Window::beginFrame() {
+    particlesystem::trace::frame();
+    PS_TRACE_SCOPE("Window::beginFrame");
+
     // Update timing
     double currentTime = glfwGetTime();
     impl->deltaTime = static_cast<float>(currentTime - impl->lastFrameTime);
@@ -354,11 +626,11 @@ void Window::beginFrame() {
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
-    int width, height;
-    glfwGetWindowSize(impl->window, &width, &height);
-
     // Update render window
-    glViewport(0, 0, width, height);
+    if (impl->headless) {
+        glBindFramebuffer(GL_FRAMEBUFFER, impl->fbo);
+    }
+    glViewport(0, 0, this->width(), this->height());
     
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -366,6 +638,12 @@ void Window::beginFrame() {
 }
 
 void Window::clear(glm::vec4 color) {
+    // Points queued before the clear must not be drawn on top of it
+    impl->flushPoints();
+    if (impl->rasterizer) {
+        impl->rasterizer->clear(color);
+    }
+
     // Clear the rendering buffer with the selected background color
     glClearColor(color.r, color.g, color.b, color.a);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -389,10 +667,7 @@ void Window::drawPoints(const std::vector<glm::vec2>& pos, const std::vector<flo
 
 void Window::drawPoints(const glm::vec2* pos_data, const float* rad_data, const glm::vec4* col_data,
                         size_t count, size_t stride_in_bytes) {
-
-    if (count > VBO_CAP) {
-        throw std::runtime_error("Too many rectangles to draw in a single call");
-    }
+    PS_TRACE_SCOPE("Window::drawPoints");
 
     if (stride_in_bytes > 0 && stride_in_bytes < sizeof(glm::vec4)) {
         // The stride is smaller than the smallest data field, which signifies an error.
@@ -402,47 +677,400 @@ void Window::drawPoints(const glm::vec2* pos_data, const float* rad_data, const
         throw std::runtime_error("Stride is smaller than the smallest data field");
     }
 
-    // Upload the passed particle information to the GPU
-    glBindBuffer(GL_ARRAY_BUFFER, impl->vbo);
-    Point* point_data = static_cast<Point*>(glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
-    if (point_data) {
+    // Upload the passed particle information to the GPU, in pieces that fit the buffer
+    for (size_t done = 0; done < count;) {
+        std::span<Point> point_data = impl->reservePoints(count - done);
+        const size_t n = point_data.size();
         if (stride_in_bytes == 0) {
-            for (size_t i = 0; i < count; ++i) {
-                point_data[i] = {pos_data[i], rad_data[i], glm::packUnorm4x8(col_data[i])};
-            }
+            packPoints(point_data, {pos_data + done, n}, {rad_data + done, n},
+                       {col_data + done, n});
         } else {
-            for (size_t i = 0; i < count; ++i) {
+            for (size_t i = 0; i < n; ++i) {
+                const size_t offset = (done + i) * stride_in_bytes;
                 const glm::vec2* p = reinterpret_cast<const glm::vec2*>(
-                    reinterpret_cast<const char*>(pos_data) + i * stride_in_bytes);
+                    reinterpret_cast<const char*>(pos_data) + offset);
                 const float* r = reinterpret_cast<const float*>(
-                    reinterpret_cast<const char*>(rad_data) + i * stride_in_bytes);
+                    reinterpret_cast<const char*>(rad_data) + offset);
                 const glm::vec4* c = reinterpret_cast<const glm::vec4*>(
-                    reinterpret_cast<const char*>(col_data) + i * stride_in_bytes);
-                point_data[i] = {*p, *r, glm::packUnorm4x8(*c)};
+                    reinterpret_cast<const char*>(col_data) + offset);
+                point_data[i] = {*p, *r, packColor(*c)};
             }
         }
-        glUnmapBuffer(GL_ARRAY_BUFFER);
+        endPoints();
+        done += n;
+    }
+}
+
+void Window::drawPoints(size_t count, const PointWriter& write, size_t chunkCount) {
+    PS_TRACE_SCOPE("Window::drawPoints");
+    chunkCount = std::clamp<size_t>(chunkCount, 1, std::max<size_t>(count, 1));
+
+    // The pool only grows, up to the hardware threads, so changing chunk counts never stop
+    // or start threads once it is large enough. parallelFor uses as many as there are chunks
+    const size_t threads =
+        std::min<size_t>(chunkCount, std::max(1u, std::thread::hardware_concurrency()));
+    if (threads > impl->writers.threadCount()) {
+        impl->writers.setThreadCount(threads);
+    }
+
+    // Chunks are sized for a full piece. A shorter piece, such as the end of a stream or the
+    // space left behind points queued earlier, is split into fewer chunks or none at all
+    const size_t chunkSize =
+        std::max((std::min(count, VBO_CAP) + chunkCount - 1) / chunkCount, MIN_CHUNK_POINTS);
+
+    // Points beyond the buffer size are streamed in pieces. A full piece is drawn as soon as
+    // the next one is reserved, so the GPU draws piece k while piece k + 1 is written
+    for (size_t done = 0; done < count;) {
+        std::span<Point> points = impl->reservePoints(count - done);
+        const size_t chunks = std::min(chunkCount, (points.size() + chunkSize - 1) / chunkSize);
+
+        // One chunk per thread, the calling thread writes the first chunk itself
+        impl->writers.parallelFor(chunks, [&](size_t i) {
+            std::span<Point> chunk = pointChunk(points, i, chunks);
+            write(chunk, done + static_cast<size_t>(chunk.data() - points.data()));
+        });
+
+        endPoints();
+        done += points.size();
+    }
+}
+
+std::span<PointVertex> Window::beginPoints(size_t count) {
+    if (count > VBO_CAP) {
+        throw std::runtime_error("Too many points for a single batch, see maxBatchSize()");
+    }
+
+    // Draw what is queued if the new points do not fit behind it
+    if (impl->mapped && impl->queued + count > VBO_CAP) {
+        impl->flushPoints();
+    }
+    if (!impl->mapped) {
+        impl->mapped = impl->openPoints();
+    }
+
+    impl->reserved = count;
+    return {impl->mapped + impl->queued, count};
+}
+
+size_t Window::maxBatchSize() { return VBO_CAP; }
+
+std::span<PointVertex> Window::Impl::reservePoints(size_t maxCount) {
+    if (mapped && queued == VBO_CAP) {
+        flushPoints();
+        // Start drawing the full piece while the next one is written
+        glFlush();
+    }
+    if (!mapped) {
+        mapped = openPoints();
+    }
+
+    reserved = std::min(maxCount, VBO_CAP - queued);
+    return {mapped + queued, reserved};
+}
+
+void Window::endPoints() {
+    impl->queued += impl->reserved;
+    impl->reserved = 0;
+}
+
+void Window::flush() { impl->flushPoints(); }
+
+void Window::startRecording(const RecordingOptions& options) {
+    impl->stopRecording();
+    impl->recorder = std::make_unique<FrameRecorder>(options);
+}
+
+void Window::stopRecording() { impl->stopRecording(); }
+
+bool Window::isRecording() const { return impl->recorder != nullptr; }
+
+RecordingStats Window::recordingStats() const {
+    return impl->recorder ? impl->recorder->stats() : RecordingStats{};
+}
+
+void Window::Impl::stopRecording() {
+    if (!recorder) {
+        return;
+    }
+    // Frames still being read back are waited for, the recorder then writes its queue
+    collectReadbacks(true);
+
+    // Readbacks that timed out are dropped, a later recording must not get their frames
+    for (Readback& readback : readbacks) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+            readback.fence = nullptr;
+            recorder->drop();
+        }
+    }
+    recorder.reset();
+}
+
+void Window::Impl::captureFrame() {
+    if (rasterizer) {
+        // The image is on the CPU already, a copy is all the recorder needs
+        std::vector<uint8_t> copy = recorder->takeBuffer(image.size());
+        std::copy(image.begin(), image.end(), copy.begin());
+        recorder->submit(std::move(copy), rasterizer->width(), rasterizer->height(), frameNumber);
+        return;
+    }
+
+    const auto freeSlot = [this]() {
+        return std::find_if(readbacks.begin(), readbacks.end(),
+                            [](const Readback& readback) { return readback.fence == nullptr; });
+    };
+    collectReadbacks(false);
+    auto slot = freeSlot();
+    if (slot == readbacks.end() && !recorder->options().dropWhenFull) {
+        collectReadbacks(true);
+        slot = freeSlot();
+    }
+    if (slot == readbacks.end()) {
+        // Every buffer is still being read, dropping the frame is better than waiting
+        recorder->drop();
+        return;
+    }
+
+    const glm::ivec2 size = framebufferSize();
+    if (slot->buffer == 0) {
+        glGenBuffers(1, &slot->buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    if (slot->width != size.x || slot->height != size.y) {
+        glBufferData(GL_PIXEL_PACK_BUFFER,
+                     static_cast<GLsizeiptr>(size.x) * static_cast<GLsizeiptr>(size.y) * 4, nullptr,
+                     GL_STREAM_READ);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->frame = frameNumber;
+    slot->width = size.x;
+    slot->height = size.y;
+    checkOpenGLError("captureFrame");
+}
+
+void Window::Impl::collectReadbacks(bool wait) {
+    while (true) {
+        // Oldest readback first, so frames reach the recorder in order
+        Readback* oldest = nullptr;
+        for (Readback& readback : readbacks) {
+            if (readback.fence && (!oldest || readback.frame < oldest->frame)) {
+                oldest = &readback;
+            }
+        }
+        if (!oldest) {
+            return;
+        }
+
+        const GLuint64 timeout = wait ? 1'000'000'000 : 0;
+        const GLenum status =
+            glClientWaitSync(oldest->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return;
+        }
+        glDeleteSync(oldest->fence);
+        oldest->fence = nullptr;
+
+        // OpenGL returns the bottom row first
+        const size_t rowSize = static_cast<size_t>(oldest->width) * 4;
+        const size_t rows = static_cast<size_t>(oldest->height);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, oldest->buffer);
+        const auto* pixels = static_cast<const uint8_t*>(glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(rowSize * rows), GL_MAP_READ_BIT));
+        if (pixels) {
+            std::vector<uint8_t> frame = recorder->takeBuffer(rowSize * rows);
+            for (size_t y = 0; y < rows; ++y) {
+                std::memcpy(frame.data() + y * rowSize, pixels + (rows - 1 - y) * rowSize, rowSize);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            recorder->submit(std::move(frame), oldest->width, oldest->height, oldest->frame);
+        } else {
+            recorder->drop();
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+void Window::setCamera(const Camera2D& camera) {
+    impl->flushPoints();
+    impl->camera = camera;
+}
+
+const Camera2D& Window::camera() const { return impl->camera; }
+
+void Window::drawDensity(std::span<const glm::vec2> pos, std::span<const glm::vec4> color,
+                         float exposure) {
+    // Keep the submission order with points drawn before
+    impl->flushPoints();
+
+    const glm::ivec2 size = impl->framebufferSize();
+    if (!impl->density) {
+        impl->density = std::make_unique<DensityGrid>(size.x, size.y);
+    } else if (size.x != impl->density->width() || size.y != impl->density->height()) {
+        impl->density->resize(size.x, size.y);
+    }
+    impl->density->bin(pos, color, impl->camera);
+    impl->densityImage.resize(static_cast<size_t>(size.x) * static_cast<size_t>(size.y) * 4);
+    impl->density->toneMap(impl->densityImage, exposure);
+
+    if (impl->rasterizer) {
+        impl->rasterizer->drawImage(impl->densityImage);
     } else {
+        impl->createImageObjects();
+        impl->drawImage(impl->densityImage, size.x, size.y, true);
+    }
+}
+
+PointVertex* Window::Impl::openPoints() {
+    if (rasterizer) {
+        cpuPoints.resize(VBO_CAP);
+        return cpuPoints.data();
+    }
+
+    if (persistent) {
+        // Move on to the next region and wait until the GPU is done with its last draw,
+        // which with several regions in flight has normally happened long ago
+        region = (region + 1) % VBO_REGIONS;
+        GLsync& fence = fences[region];
+        if (fence) {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000) ==
+                   GL_TIMEOUT_EXPIRED) {
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        return persistent + region * VBO_CAP;
+    }
+
+    // Orphan the old storage so the driver can hand out fresh memory instead of waiting
+    // for pending draws. The buffer stays mapped until the queued points are drawn
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, VBO_CAP * sizeof(Point), nullptr, GL_STREAM_DRAW);
+    Point* point_data = static_cast<Point*>(
+        glMapBufferRange(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(VBO_CAP * sizeof(Point)),
+                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!point_data) {
         throw std::runtime_error("Failed to map buffer");
     }
+    return point_data;
+}
+
+void Window::Impl::flushPoints() {
+    if (!mapped) {
+        return;
+    }
+    PS_TRACE_SCOPE("Window::flushPoints");
 
-    glBindVertexArray(impl->vao);
-    glUseProgram(impl->program);
-    glDrawArrays(GL_POINTS, 0, static_cast<int>(count));
-    glUseProgram(0);
-    glBindVertexArray(0);
+    if (rasterizer) {
+        if (camera.center != glm::vec2(0.0f, 0.0f) || camera.zoom != 1.0f) {
+            for (size_t i = 0; i < queued; ++i) {
+                mapped[i].position = camera.toScreen(mapped[i].position);
+                mapped[i].scale *= camera.zoom;
+            }
+        }
+        rasterizer->drawPoints({mapped, queued});
+        mapped = nullptr;
+        queued = 0;
+        return;
+    }
+
+    GLint first = 0;
+    if (persistent) {
+        // The mapping is coherent, so the writes are visible without flushing
+        first = static_cast<GLint>(region * VBO_CAP);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+
+    // All queued batches share the same state, so one draw keeps their order
+    if (queued > 0) {
+        glBindVertexArray(vao);
+        glUseProgram(program);
+        glUniform2f(cameraCenterLocation, camera.center.x, camera.center.y);
+        glUniform1f(cameraZoomLocation, camera.zoom);
+        glDrawArrays(GL_POINTS, first, static_cast<int>(queued));
+        glUseProgram(0);
+        glBindVertexArray(0);
+    }
+
+    if (persistent) {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    mapped = nullptr;
+    queued = 0;
 
     checkOpenGLError("drawPoint");
 }
 
+bool Window::usesPersistentMapping() const { return impl->persistent != nullptr; }
+
+WindowMemory Window::memoryStats() const {
+    WindowMemory memory;
+    memory.vertexBuffer = (impl->persistent ? VBO_REGIONS : 1) * VBO_CAP * sizeof(Point);
+    for (const Impl::Readback& readback : impl->readbacks) {
+        if (readback.buffer != 0) {
+            memory.readback += static_cast<size_t>(readback.width) *
+                               static_cast<size_t>(readback.height) * 4;
+        }
+    }
+    if (impl->rasterizer) {
+        memory.software = impl->rasterizer->memoryBytes() +
+                          impl->cpuPoints.capacity() * sizeof(Point) + impl->image.capacity();
+    }
+    if (impl->density) {
+        memory.density = impl->density->memoryBytes() + impl->densityImage.capacity();
+    }
+    if (impl->recorder) {
+        memory.recorder = impl->recorder->stats().bufferBytes;
+    }
+    memory.total = memory.vertexBuffer + memory.readback + memory.software + memory.density +
+                   memory.recorder;
+    memory.peak = std::max(impl->peakMemory, memory.total);
+    return memory;
+}
+
+void packPoints(std::span<PointVertex> out, std::span<const glm::vec2> pos,
+                std::span<const float> radius, std::span<const glm::vec4> color) {
+    const size_t count = std::min({out.size(), pos.size(), radius.size(), color.size()});
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = {pos[i], radius[i], packColor(color[i])};
+    }
+}
+
+std::span<PointVertex> pointChunk(std::span<PointVertex> points, size_t index, size_t chunkCount) {
+    const size_t begin = points.size() * index / chunkCount;
+    const size_t end = points.size() * (index + 1) / chunkCount;
+    return points.subspan(begin, end - begin);
+}
+
 void Window::endFrame() {
+    PS_TRACE_SCOPE("Window::endFrame");
+
+    // Draw all points queued during the frame below the user interface
+    impl->flushPoints();
+    if (impl->rasterizer) {
+        impl->presentImage();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+    if (impl->recorder) {
+        impl->captureFrame();
+    }
+    ++impl->frameNumber;
+    impl->peakMemory = memoryStats().peak;
+
     // Swapping the front and back buffer. Since we are doing v-sync is enabled, this
     // call will block until its our turn to swap the buffers (usually every 16.6 ms
     // on a 60 Hz monitor
-    glfwSwapBuffers(impl->window);
+    if (!impl->headless) {
+        glfwSwapBuffers(impl->window);
+    }
 
     checkOpenGLError("endFrame");
 }
@@ -497,15 +1125,113 @@ glm::vec2 Window::mousePosition() const {
 }
 
 int Window::width() const {
+    if (impl->headless) {
+        return impl->headlessWidth;
+    }
     int width, height;
     glfwGetWindowSize(impl->window, &width, &height);
     return width;
 }
 
 int Window::height() const {
+    if (impl->headless) {
+        return impl->headlessHeight;
+    }
     int width, height;
     glfwGetWindowSize(impl->window, &width, &height);
     return height;
 }
 
+bool Window::headless() const { return impl->headless; }
+
+std::vector<uint8_t> Window::readPixels() {
+    impl->flushPoints();
+    if (impl->rasterizer) {
+        return impl->rasterizer->readPixels();
+    }
+    return impl->readFramebuffer();
+}
+
+std::vector<uint8_t> Window::Impl::readFramebuffer() {
+    int w = 0;
+    int h = 0;
+    if (headless) {
+        w = headlessWidth;
+        h = headlessHeight;
+    } else {
+        glfwGetFramebufferSize(window, &w, &h);
+    }
+
+    const size_t rowSize = static_cast<size_t>(w) * 4;
+    std::vector<uint8_t> pixels(rowSize * static_cast<size_t>(h));
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    // OpenGL returns the bottom row first
+    for (size_t y = 0; y < static_cast<size_t>(h) / 2; ++y) {
+        const auto top = pixels.begin() + static_cast<std::ptrdiff_t>(y * rowSize);
+        const auto bottom =
+            pixels.begin() + static_cast<std::ptrdiff_t>((static_cast<size_t>(h) - 1 - y) * rowSize);
+        std::swap_ranges(top, top + static_cast<std::ptrdiff_t>(rowSize), bottom);
+    }
+
+    checkOpenGLError("readPixels");
+    return pixels;
+}
+
+void Window::Impl::createImageObjects() {
+    if (imageProgram != 0) {
+        return;
+    }
+    imageProgram = createImageProgram();
+    glGenVertexArrays(1, &imageVao);
+    glGenTextures(1, &imageTexture);
+    glBindTexture(GL_TEXTURE_2D, imageTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+glm::ivec2 Window::Impl::framebufferSize() const {
+    glm::ivec2 size{headlessWidth, headlessHeight};
+    if (!headless) {
+        glfwGetFramebufferSize(window, &size.x, &size.y);
+    }
+    return size;
+}
+
+void Window::Impl::presentImage() {
+    // Follow the window size
+    const glm::ivec2 size = framebufferSize();
+    if (size.x != rasterizer->width() || size.y != rasterizer->height()) {
+        rasterizer->resize(size.x, size.y);
+        rasterizer->clear({0.0f, 0.0f, 0.0f, 1.0f});
+    }
+
+    image.resize(static_cast<size_t>(size.x) * static_cast<size_t>(size.y) * 4);
+    rasterizer->readPixels(image);
+    drawImage(image, size.x, size.y, false);
+}
+
+void Window::Impl::drawImage(std::span<const uint8_t> rgba, int w, int h, bool blend) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, imageTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    if (!blend) {
+        glDisable(GL_BLEND);
+    }
+    glUseProgram(imageProgram);
+    glBindVertexArray(imageVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_BLEND);
+
+    checkOpenGLError("drawImage");
+}
+
 }  // namespace rendering
@@ -0,0 +1,158 @@
+#include <catch2/catch_test_macros.hpp>
+#include <particlesystem/all.h>
+#include <example/particle_demo.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Every heap allocation of the test binary goes through these replacements of the global
+// operator new, which count them. Once warmed up, the per-frame path must not allocate.
+// The replacements apply to the whole program, so these tests are their own executable.
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+
+void* allocate(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* allocate(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+    if (void* p = std::aligned_alloc(align, rounded)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Counts the allocations made while running f
+template <typename F>
+size_t countAllocations(F&& f) {
+    const size_t before = allocationCount.load();
+    f();
+    return allocationCount.load() - before;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocate(size, alignment);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+TEST_CASE("Allocations are counted", "[allocation]") {
+    REQUIRE(countAllocations([]() { auto p = std::make_unique<int>(1); }) == 1);
+    REQUIRE(countAllocations([]() { std::vector<int> v(16); }) == 1);
+}
+
+TEST_CASE("Particle system update does not allocate once warmed up", "[allocation]") {
+    ps::ParticleSystem system;
+    system.setBounds(glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f), 0.8f);
+    system.setCullRect(glm::vec2(-0.5f, -0.5f), glm::vec2(1.0f, 1.0f));
+    system.setRenderBudget(2000);
+
+    auto uniform = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+    uniform->setRate(2000.0f);
+    system.addEmitter(uniform);
+    auto directional = std::make_shared<ps::DirectionalEmitter>(glm::vec2(-0.5f, 0.0f),
+                                                                glm::vec2(1.0f, 0.0f));
+    directional->setRate(1000.0f);
+    system.addEmitter(directional);
+    auto explosion = std::make_shared<ps::ExplosionEmitter>(glm::vec2(0.5f, 0.5f));
+    system.addEmitter(explosion);
+    auto ring = std::make_shared<ps::RingEmitter>(glm::vec2(0.0f, -0.5f), 0.3f, 0.1f);
+    ring->setRate(1000.0f);
+    system.addEmitter(ring);
+    auto polygon = std::make_shared<ps::PolygonEmitter>(
+        glm::vec2(0.0f, 0.0f),
+        std::vector<glm::vec2>{{-0.2f, -0.2f}, {0.2f, -0.2f}, {0.0f, 0.2f}});
+    polygon->setSamplingMode(ps::SamplingMode::LowDiscrepancy);
+    polygon->setRate(1000.0f);
+    system.addEmitter(polygon);
+    system.addEffect(std::make_shared<ps::GravityWell>(glm::vec2(0.0f, 0.0f)));
+    auto wind = std::make_shared<ps::Wind>(glm::vec2(1.0f, 0.0f));
+    wind->setVarying(true);
+    system.addEffect(wind);
+
+    const auto run = [&](int frames) {
+        for (int frame = 0; frame < frames; ++frame) {
+            if (frame % 30 == 0) {
+                explosion->trigger();
+            }
+            wind->update(static_cast<float>(frame) / 60.0f);
+            system.update(1.0f / 60.0f);
+        }
+    };
+
+    // Storage grows during the first seconds, after that the particle count is stable
+    run(600);
+    REQUIRE(system.getAliveCount() > 0);
+    REQUIRE(countAllocations([&]() { run(600); }) == 0);
+
+    // Emitting on worker threads reuses the same threads every update
+    system.setThreadCount(3);
+    run(60);
+    REQUIRE(countAllocations([&]() { run(600); }) == 0);
+}
+
+TEST_CASE("Particle demo update does not allocate once warmed up", "[allocation]") {
+    example::ParticleDemo demo;
+    const std::vector<std::pair<example::PlacementMode, glm::vec2>> scene = {
+        {example::PlacementMode::UniformEmitter, {0.0f, 0.0f}},
+        {example::PlacementMode::DirectionalEmitter, {-0.5f, 0.0f}},
+        {example::PlacementMode::ExplosionEmitter, {0.5f, 0.5f}},
+        {example::PlacementMode::RingEmitter, {0.0f, -0.5f}},
+        {example::PlacementMode::GravityWell, {0.3f, 0.3f}},
+        {example::PlacementMode::Wind, {-0.3f, -0.3f}},
+    };
+    for (const auto& [mode, position] : scene) {
+        demo.setPlacementMode(mode);
+        demo.handleMouseClick(position);
+    }
+
+    double time = 0.0;
+    const auto run = [&](int frames) {
+        for (int frame = 0; frame < frames; ++frame) {
+            time += 1.0 / 60.0;
+            demo.update(time, 1.0f / 60.0f, glm::vec2(0.0f, 0.0f));
+            demo.acquireFrame();
+        }
+    };
+
+    run(600);
+    REQUIRE(!demo.getPositions().empty());
+    REQUIRE(countAllocations([&]() { run(600); }) == 0);
+}
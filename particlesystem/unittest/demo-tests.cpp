@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include <glm/glm.hpp>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <example/particle_demo.h>
+#include "batch.h"
+
+namespace {
+
+// Runs parseBatchOptions on a command line without the program name
+std::optional<BatchOptions> parse(std::vector<std::string> args) {
+    args.insert(args.begin(), "application");
+    std::vector<char*> argv;
+    for (std::string& arg : args) {
+        argv.push_back(arg.data());
+    }
+    return parseBatchOptions(static_cast<int>(argv.size()), argv.data());
+}
+
+}  // namespace
+
+TEST_CASE("Particle demo loads scenes", "[ParticleDemo]") {
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "particlesystem-test.scene";
+    {
+        std::ofstream file(path);
+        file << "# Test scene\n"
+             << "\n"
+             << "uniform 0.0 0.0 600\n"
+             << "ring 0.5 0.5\n"
+             << "gravitywell 0.0 0.5 0.2\n";
+    }
+
+    // Same seed, same scene and same initial particles give the same run
+    const auto run = [&path](uint64_t seed) {
+        example::ParticleDemo demo;
+        demo.loadScene(path.string());
+        demo.setSeed(seed);
+        demo.addParticles(100, 10.0f, seed);
+        for (int frame = 0; frame < 30; ++frame) {
+            demo.update(frame / 60.0, 1.0f / 60.0f, glm::vec2(0.0f, 0.0f));
+        }
+        // Copy, the positions belong to the demo
+        const auto positions = demo.getSystem().getPositions();
+        return std::vector<glm::vec2>(positions.begin(), positions.end());
+    };
+    const std::vector<glm::vec2> first = run(3);
+    const std::vector<glm::vec2> second = run(3);
+    REQUIRE(first.size() > 100 + 10 * 30 / 2);
+    REQUIRE(first == second);
+
+    std::ofstream(path) << "uniform 0.0\n";
+    example::ParticleDemo demo;
+    REQUIRE_THROWS_AS(demo.loadScene(path.string()), std::runtime_error);
+    std::ofstream(path) << "comet 0.0 0.0\n";
+    REQUIRE_THROWS_AS(demo.loadScene(path.string()), std::runtime_error);
+    REQUIRE_THROWS_AS(demo.loadScene((path.parent_path() / "missing.scene").string()),
+                      std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Batch options", "[ParticleDemo]") {
+    // Without --headless the application runs interactively
+    REQUIRE_FALSE(parse({}).has_value());
+
+    const auto defaults = parse({"--headless"});
+    REQUIRE(defaults.has_value());
+    REQUIRE(defaults->frames == BatchOptions{}.frames);
+    REQUIRE(defaults->scene.empty());
+
+    const auto options = parse({"--frames", "100", "--headless", "--dt", "0.5", "--scene",
+                                "a.scene", "--particles", "0x10", "--seed", "7", "--threads",
+                                "3"});
+    REQUIRE(options.has_value());
+    REQUIRE(options->frames == 100);
+    REQUIRE(options->dt == 0.5f);
+    REQUIRE(options->scene == "a.scene");
+    REQUIRE(options->particles == 16);
+    REQUIRE(options->seed == 7);
+    REQUIRE(options->threads == 3);
+
+    REQUIRE_THROWS_AS(parse({"--headless", "--comet", "1"}), std::runtime_error);
+    REQUIRE_THROWS_AS(parse({"--headless", "--frames"}), std::runtime_error);
+    REQUIRE_THROWS_AS(parse({"--headless", "--frames", "many"}), std::runtime_error);
+    REQUIRE_THROWS_AS(parse({"--headless", "--dt", "0.5s"}), std::runtime_error);
+    REQUIRE_THROWS_AS(parse({"--frames", "100"}), std::runtime_error);
+    REQUIRE_THROWS_AS(parse({"--help"}), std::runtime_error);
+}
@@ -1,7 +1,17 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <particlesystem/all.h>
 #include <memory>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <array>
+#include <cmath>
+#include <set>
+#include <vector>
 #include <glm/geometric.hpp>
 
 using namespace Catch::Matchers;
@@ -108,3 +118,692 @@ TEST_CASE("Particle System with Effect", "[particlesystem]") {
  * Docs: https://github.com/catchorg/Catch2/blob/devel/docs/Readme.md
  */
 
+
+TEST_CASE("Triple Buffer hands over the latest frame", "[triplebuffer]") {
+    ps::TripleBuffer<int> buffer;
+    
+    // Nothing has been published yet
+    REQUIRE_FALSE(buffer.acquire());
+    
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+    
+    // The consumer only sees the most recent frame
+    REQUIRE(buffer.acquire());
+    REQUIRE(buffer.front() == 2);
+    
+    // Acquiring again without a new frame keeps the current one
+    REQUIRE_FALSE(buffer.acquire());
+    REQUIRE(buffer.front() == 2);
+    
+    // The producer never writes to the slot the consumer holds
+    buffer.back() = 3;
+    REQUIRE(buffer.front() == 2);
+    buffer.publish();
+    REQUIRE(buffer.acquire());
+    REQUIRE(buffer.front() == 3);
+}
+
+TEST_CASE("Spawn Queue collects particles from many threads", "[spawnqueue]") {
+    ps::SpawnQueue queue;
+    REQUIRE(queue.empty());
+    
+    constexpr int threadCount = 4;
+    constexpr int batchesPerThread = 100;
+    constexpr size_t batchSize = 10;
+    
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threadCount; ++t) {
+        producers.emplace_back([&queue]() {
+            for (int b = 0; b < batchesPerThread; ++b) {
+                ps::Particle particle;
+                particle.alive = true;
+                queue.submit(std::vector<ps::Particle>(batchSize, particle));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    
+    std::vector<ps::Particle> particles;
+    REQUIRE(queue.drain(particles) == threadCount * batchesPerThread * batchSize);
+    REQUIRE(particles.size() == threadCount * batchesPerThread * batchSize);
+    REQUIRE(queue.empty());
+    
+    // Draining again adds nothing
+    REQUIRE(queue.drain(particles) == 0);
+}
+
+TEST_CASE("Particle System merges queued and emitted particles", "[particlesystem]") {
+    ps::ParticleSystem system;
+    system.setThreadCount(4);
+    
+    for (int i = 0; i < 8; ++i) {
+        auto emitter = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+        emitter->setRate(100.0f);
+        system.addEmitter(emitter);
+    }
+    
+    ps::Particle particle;
+    particle.lifetime = 10.0f;
+    particle.alive = true;
+    system.getSpawnQueue().push(particle);
+    
+    system.update(0.1f);
+    
+    // 8 emitters at 100 particles per second for 0.1 seconds, plus the queued particle
+    REQUIRE(system.getParticles().size() >= 8 * 9 + 1);
+    REQUIRE(system.getSpawnQueue().empty());
+}
+
+TEST_CASE("Philox matches the reference implementation", "[random]") {
+    // Known answer from the Random123 test vectors
+    const auto zero = ps::philox4x32({0u, 0u, 0u, 0u}, {0u, 0u});
+    REQUIRE(zero[0] == 0x6627e8d5u);
+    REQUIRE(zero[1] == 0xe169c58du);
+    REQUIRE(zero[2] == 0xbc57ac4cu);
+    REQUIRE(zero[3] == 0x9b00dbd8u);
+    
+    ps::CounterRng rng{1234, 5};
+    for (uint32_t i = 0; i < 100; ++i) {
+        for (float u : rng.uniform4(7, i)) {
+            REQUIRE(u >= 0.0f);
+            REQUIRE(u < 1.0f);
+        }
+    }
+}
+
+TEST_CASE("Emission is independent of the thread count", "[random][particlesystem]") {
+    auto run = [](size_t threads) {
+        ps::ParticleSystem system;
+        system.setThreadCount(threads);
+        for (uint32_t i = 0; i < 6; ++i) {
+            auto emitter = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+            emitter->setRate(200.0f);
+            emitter->setSeed(42);
+            emitter->setStream(i);
+            system.addEmitter(emitter);
+        }
+        for (int frame = 0; frame < 5; ++frame) {
+            system.update(0.05f);
+        }
+        return system.getParticles();
+    };
+    
+    const auto serial = run(1);
+    const auto parallel = run(4);
+    REQUIRE_FALSE(serial.empty());
+    REQUIRE(serial.size() == parallel.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        REQUIRE(serial[i].position == parallel[i].position);
+        REQUIRE(serial[i].velocity == parallel[i].velocity);
+        REQUIRE(serial[i].lifetime == parallel[i].lifetime);
+    }
+}
+
+TEST_CASE("Emitters stop at the particle limit", "[particlesystem]") {
+    ps::ParticleSystem system;
+    REQUIRE(system.getMaxParticles() == ps::ParticleSystem::defaultMaxParticles);
+    system.setMaxParticles(1500);
+    
+    // Two emitters together ask for more than the limit, the first one is served first.
+    // A power of two rate emits exactly one particle per 1/rate seconds
+    auto first = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+    auto second = std::make_shared<ps::UniformEmitter>(glm::vec2(100.0f, 0.0f));
+    for (auto& emitter : {first, second}) {
+        emitter->setRate(1024.0f);
+        emitter->setLifetimeRange(100.0f, 100.0f);
+        system.addEmitter(emitter);
+    }
+    system.update(1.0f);
+    REQUIRE(system.getAliveCount() == 1500);
+    size_t fromFirst = 0;
+    for (const auto& particle : system.getParticles()) {
+        fromFirst += particle.position.x < 50.0f ? 1 : 0;
+    }
+    REQUIRE(fromFirst == 1024);
+    system.update(1.0f);
+    REQUIRE(system.getAliveCount() == 1500);
+    
+    // Particles submitted on purpose are not limited
+    std::vector<ps::Particle> submitted(100);
+    for (auto& particle : submitted) {
+        particle.alive = true;
+        particle.lifetime = 100.0f;
+    }
+    system.getSpawnQueue().submit(submitted);
+    system.update(0.0f);
+    REQUIRE(system.getAliveCount() == 1600);
+    
+    // Raising the limit lets the emitters continue
+    system.setMaxParticles(4000);
+    system.update(1.0f);
+    REQUIRE(system.getAliveCount() == 3648);
+}
+
+TEST_CASE("Explosion emits all particles in one bulk step", "[emitter]") {
+    auto explosion = std::make_shared<ps::ExplosionEmitter>(glm::vec2(0.5f, -0.5f));
+    explosion->setParticleCount(100'000);
+    explosion->setSpeedRange(1.0f, 2.0f);
+    
+    std::vector<ps::Particle> particles;
+    explosion->emit(particles, 0.1f);
+    REQUIRE(particles.empty());  // Not triggered yet
+    
+    explosion->trigger();
+    explosion->emit(particles, 0.1f);
+    REQUIRE(particles.size() == 100'000);
+    for (const auto& particle : particles) {
+        REQUIRE(particle.alive);
+        REQUIRE(particle.position == glm::vec2(0.5f, -0.5f));
+        const float speed = glm::length(particle.velocity);
+        REQUIRE(speed >= 1.0f - 1e-4f);
+        REQUIRE(speed <= 2.0f + 1e-4f);
+    }
+}
+
+TEST_CASE("Rate based emitters compute the spawn count up front", "[emitter]") {
+    ps::UniformEmitter emitter{glm::vec2(0.0f, 0.0f)};
+    emitter.setRate(8.0f);
+    
+    std::vector<ps::Particle> particles;
+    emitter.emit(particles, 0.5625f);
+    REQUIRE(particles.size() == 4);
+    
+    // The remaining half particle carries over to the next step
+    emitter.emit(particles, 0.0625f);
+    REQUIRE(particles.size() == 5);
+}
+
+TEST_CASE("Benchmark explosion", "[.benchmark]") {
+    auto explosion = std::make_shared<ps::ExplosionEmitter>(glm::vec2(0.0f, 0.0f));
+    explosion->setParticleCount(100'000);
+    std::vector<ps::Particle> particles;
+    particles.reserve(100'000);
+    
+    BENCHMARK("100'000 particle explosion") {
+        particles.clear();
+        explosion->trigger();
+        explosion->emit(particles, 0.1f);
+        return particles.size();
+    };
+}
+
+TEST_CASE("Low-discrepancy samples cover the unit square evenly", "[random]") {
+    ps::LowDiscrepancySequence sequence{99, 3};
+    
+    std::vector<ps::LowDiscrepancySequence::Point> points(256);
+    sequence.next(points);
+    
+    // Every one of 16 strata gets almost exactly its share of the 256 points
+    for (size_t d = 0; d < ps::LowDiscrepancySequence::dimensions; ++d) {
+        std::array<int, 16> bins{};
+        for (const auto& point : points) {
+            REQUIRE(point[d] >= 0.0f);
+            REQUIRE(point[d] < 1.0f);
+            ++bins[static_cast<size_t>(point[d] * 16.0f)];
+        }
+        for (int count : bins) {
+            REQUIRE(count >= 14);
+            REQUIRE(count <= 18);
+        }
+    }
+    
+    // Different scrambles give different points
+    ps::LowDiscrepancySequence other{99, 4};
+    std::vector<ps::LowDiscrepancySequence::Point> otherPoints(256);
+    other.next(otherPoints);
+    REQUIRE(points != otherPoints);
+}
+
+TEST_CASE("Emitters support low-discrepancy sampling", "[emitter]") {
+    ps::UniformEmitter emitter{glm::vec2(0.0f, 0.0f)};
+    emitter.setSamplingMode(ps::SamplingMode::LowDiscrepancy);
+    emitter.setSpeedRange(1.0f, 1.0f);
+    emitter.setRate(64.0f);
+    
+    std::vector<ps::Particle> particles;
+    emitter.emit(particles, 1.0f);
+    REQUIRE(particles.size() == 64);
+    
+    // Each of 16 angular sectors gets close to its share of 4 particles, white noise
+    // routinely leaves sectors empty or doubles them up
+    std::array<int, 16> sectors{};
+    for (const auto& particle : particles) {
+        const float angle = std::atan2(particle.velocity.y, particle.velocity.x) +
+                            glm::pi<float>();
+        ++sectors[std::min<size_t>(static_cast<size_t>(angle / (2.0f * glm::pi<float>()) * 16.0f),
+                                   15)];
+    }
+    for (int count : sectors) {
+        REQUIRE(count >= 3);
+        REQUIRE(count <= 5);
+    }
+}
+
+TEST_CASE("Alias tables sample in proportion to the weights", "[random]") {
+    ps::AliasTable table;
+    const std::vector<float> weights = {1.0f, 0.0f, 3.0f, 4.0f};
+    table.build(weights);
+    REQUIRE(table.size() == 4);
+    
+    ps::CounterRng rng{7};
+    std::array<int, 4> counts{};
+    constexpr int samples = 80'000;
+    for (int i = 0; i < samples; ++i) {
+        const auto u = rng.uniform4(0, static_cast<uint32_t>(i));
+        ++counts[table.sample(u[0], u[1])];
+    }
+    
+    for (size_t i = 0; i < weights.size(); ++i) {
+        const double expected = samples * weights[i] / 8.0;
+        REQUIRE(counts[i] >= 0.95 * expected);
+        REQUIRE(counts[i] <= 1.05 * expected);
+    }
+    
+    // Nothing to sample from without positive weights
+    table.build(std::vector<float>{0.0f, -1.0f});
+    REQUIRE(table.empty());
+}
+
+TEST_CASE("Shape emitters spawn on their shape", "[emitter]") {
+    const glm::vec2 center(0.5f, -0.25f);
+    std::vector<ps::Particle> particles;
+    
+    SECTION("Ring outline") {
+        ps::RingEmitter ring{center, 0.5f};
+        ring.setRate(1024.0f);
+        ring.emit(particles, 1.0f);
+        REQUIRE(particles.size() == 1024);
+        for (const auto& particle : particles) {
+            // Chords dip slightly inside the circle
+            const float r = ps::length(particle.position - center);
+            REQUIRE(r <= 0.5f + 1e-5f);
+            REQUIRE(r >= 0.499f);
+        }
+    }
+    
+    SECTION("Concave polygon") {
+        // An L shape: the square [0, 2] x [0, 2] without the quadrant [1, 2] x [1, 2]
+        ps::PolygonEmitter polygon{center, {{0, 0}, {2, 0}, {2, 1}, {1, 1}, {1, 2}, {0, 2}}};
+        REQUIRE(polygon.getPrimitiveCount() == 4);
+        polygon.setRate(3000.0f);
+        polygon.emit(particles, 1.0f);
+        
+        std::array<int, 3> quadrants{};
+        for (const auto& particle : particles) {
+            const glm::vec2 p = particle.position - center;
+            REQUIRE(p.x >= -1e-5f);
+            REQUIRE(p.y >= -1e-5f);
+            REQUIRE_FALSE((p.x > 1.0f + 1e-5f && p.y > 1.0f + 1e-5f));
+            ++quadrants[p.y > 1.0f ? 2 : (p.x > 1.0f ? 1 : 0)];
+        }
+        // Each remaining unit square holds a third of the area
+        for (int count : quadrants) {
+            REQUIRE(count >= 900);
+            REQUIRE(count <= 1100);
+        }
+    }
+    
+    SECTION("Bitmap mask") {
+        // Only the bottom-right pixel of a 2 x 2 mask is set
+        ps::MaskEmitter mask{center, 2, 2, {0.0f, 0.0f, 0.0f, 1.0f}, 0.5f};
+        mask.setSamplingMode(ps::SamplingMode::LowDiscrepancy);
+        mask.setRate(100.0f);
+        mask.emit(particles, 1.0f);
+        for (const auto& particle : particles) {
+            const glm::vec2 p = particle.position - center;
+            REQUIRE(p.x >= 0.0f);
+            REQUIRE(p.x <= 0.5f);
+            REQUIRE(p.y <= 0.0f);
+            REQUIRE(p.y >= -0.5f);
+        }
+    }
+}
+
+TEST_CASE("Render columns track the live particles", "[system]") {
+    ps::ParticleSystem system;
+    system.setBounds(glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f), 0.5f);
+    
+    std::vector<ps::Particle> spawns(3);
+    for (size_t i = 0; i < spawns.size(); ++i) {
+        spawns[i].alive = true;
+        spawns[i].lifetime = static_cast<float>(i) + 0.5f;
+        spawns[i].velocity = glm::vec2(4.0f, 0.0f);
+    }
+    system.getSpawnQueue().submit(spawns);
+    
+    // The first particle dies and the others hit the right wall
+    system.update(0.75f);
+    REQUIRE(system.getAliveCount() == 2);
+    REQUIRE(system.getPositions().size() == 2);
+    REQUIRE(system.getColors().size() == 2);
+    REQUIRE(system.getSizes().size() == 2);
+    
+    for (size_t i = 0; i < system.getAliveCount(); ++i) {
+        const ps::Particle& particle = system.getParticles()[i];
+        REQUIRE(system.getPositions()[i] == particle.position);
+        REQUIRE(particle.position.x == 1.0f);
+        REQUIRE(particle.velocity.x == -2.0f);
+    }
+    
+    system.clearParticles();
+    REQUIRE(system.getAliveCount() == 0);
+}
+
+TEST_CASE("Render budget keeps a stable subset", "[particlesystem]") {
+    ps::ParticleSystem system;
+    
+    // Identical resting particles, told apart by their position
+    constexpr size_t count = 20000;
+    std::vector<ps::Particle> spawns(count);
+    for (size_t i = 0; i < count; ++i) {
+        spawns[i].alive = true;
+        spawns[i].lifetime = 100.0f;
+        spawns[i].position = glm::vec2(static_cast<float>(i), 0.0f);
+    }
+    system.getSpawnQueue().submit(spawns);
+    system.update(0.015625f);
+    REQUIRE(system.getRenderCount() == count);
+    const float size = system.getSizes()[0];
+    
+    constexpr size_t budget = 2000;
+    system.setRenderBudget(budget);
+    system.update(0.015625f);
+    REQUIRE(system.getAliveCount() == count);
+    REQUIRE(system.getRenderCount() == budget);
+    REQUIRE(system.getPositions().size() == system.getRenderCount());
+    
+    // Kept particles cover as much as all of them did
+    float coverage = 0.0f;
+    for (size_t i = 0; i < system.getRenderCount(); ++i) {
+        coverage += system.getColors()[i].a * system.getSizes()[i] * system.getSizes()[i];
+    }
+    const float expected = static_cast<float>(count) * size * size;
+    REQUIRE(coverage > expected * 0.9f);
+    REQUIRE(coverage < expected * 1.1f);
+    
+    // The same particles are kept in the next frame
+    const std::vector<glm::vec2> kept(system.getPositions().begin(), system.getPositions().end());
+    system.update(0.015625f);
+    REQUIRE(std::vector<glm::vec2>(system.getPositions().begin(), system.getPositions().end()) == kept);
+    
+    // New particles change which of the old ones are kept only slightly
+    system.getSpawnQueue().submit(std::vector<ps::Particle>(spawns.begin(), spawns.begin() + 100));
+    system.update(0.015625f);
+    std::set<float> current;
+    for (const glm::vec2& position : system.getPositions()) {
+        current.insert(position.x);
+    }
+    size_t stillKept = 0;
+    for (const glm::vec2& position : kept) {
+        stillKept += current.count(position.x);
+    }
+    REQUIRE(stillKept > kept.size() * 9 / 10);
+    
+    system.setRenderBudget(0);
+    system.update(0.015625f);
+    REQUIRE(system.getRenderCount() == system.getAliveCount());
+    
+    // Fading particles of different importance with new ones spawning every frame. Exactly
+    // the budget is kept, and a particle that was kept, including the newest ones at the end
+    // of the columns, is only dropped at the margin of the sampling threshold
+    ps::ParticleSystem fading;
+    fading.setRenderBudget(budget);
+    ps::BatchRng rng{11};
+    float nextX = 0.0f;
+    const auto spawn = [&](size_t n) {
+        std::vector<ps::Particle> batch(n);
+        for (ps::Particle& particle : batch) {
+            particle.alive = true;
+            particle.lifetime = rng.next(0.5f, 4.0f);
+            particle.position = glm::vec2(nextX++, 0.0f);
+        }
+        fading.getSpawnQueue().submit(std::move(batch));
+    };
+    const auto keptPositions = [&fading]() {
+        std::set<float> positions;
+        for (const glm::vec2& position : fading.getPositions()) {
+            positions.insert(position.x);
+        }
+        return positions;
+    };
+    spawn(count);
+    fading.update(0.015625f);
+    std::set<float> previous = keptPositions();
+    for (int frame = 0; frame < 30; ++frame) {
+        const float newest = nextX - 2000.0f;
+        spawn(200);
+        fading.update(0.015625f);
+        REQUIRE(fading.getRenderCount() == budget);
+        
+        const std::set<float> current = keptPositions();
+        size_t dropped = 0;
+        size_t newestKept = 0;
+        size_t newestDropped = 0;
+        for (float x : previous) {
+            const bool isNew = x >= newest;
+            const bool isDropped = current.count(x) == 0;
+            dropped += isDropped ? 1 : 0;
+            newestKept += isNew ? 1 : 0;
+            newestDropped += isNew && isDropped ? 1 : 0;
+        }
+        REQUIRE(dropped < budget / 40);
+        REQUIRE(newestDropped <= newestKept / 20);
+        previous = current;
+    }
+}
+
+TEST_CASE("Cull rect leaves particles outside out of the render columns", "[particlesystem]") {
+    ps::ParticleSystem system;
+    
+    // Resting particles spread over [-4, 4], whole blocks are inside, outside and across
+    constexpr size_t count = 8 * ps::ParticleSystem::cullBlockSize;
+    std::vector<ps::Particle> spawns(count);
+    size_t expected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        spawns[i].alive = true;
+        spawns[i].lifetime = 100.0f;
+        spawns[i].position = glm::vec2(static_cast<float>(i) / 1024.0f - 4.0f, 0.5f);
+        expected += spawns[i].position.x >= -1.5f && spawns[i].position.x <= 0.25f ? 1 : 0;
+    }
+    system.getSpawnQueue().submit(spawns);
+    
+    system.setCullRect(glm::vec2(-1.5f, -1.0f), glm::vec2(0.25f, 1.0f));
+    system.update(0.015625f);
+    REQUIRE(system.getAliveCount() == count);
+    REQUIRE(system.getRenderCount() == expected);
+    for (size_t i = 0; i < system.getRenderCount(); ++i) {
+        REQUIRE(system.getPositions()[i].x >= -1.5f);
+        REQUIRE(system.getPositions()[i].x <= 0.25f);
+        if (i > 0) {
+            REQUIRE(system.getPositions()[i].x > system.getPositions()[i - 1].x);
+        }
+    }
+    
+    // Nothing is exported when the rect misses every particle
+    system.setCullRect(glm::vec2(-1.0f, 2.0f), glm::vec2(1.0f, 3.0f));
+    system.update(0.015625f);
+    REQUIRE(system.getRenderCount() == 0);
+    
+    system.clearCullRect();
+    system.update(0.015625f);
+    REQUIRE(system.getRenderCount() == count);
+}
+
+TEST_CASE("Cull rect with scattered particles", "[particlesystem]") {
+    ps::ParticleSystem system;
+    
+    // Consecutive particles are far apart, so every block spans the rect and each particle
+    // is tested
+    constexpr size_t count = 8 * ps::ParticleSystem::cullBlockSize;
+    std::vector<glm::vec2> positions(count);
+    ps::BatchRng rng{5};
+    rng.uniform(positions, glm::vec2(-4.0f, -4.0f), glm::vec2(4.0f, 4.0f));
+    std::vector<ps::Particle> spawns(count);
+    std::vector<glm::vec2> expected;
+    for (size_t i = 0; i < count; ++i) {
+        spawns[i].alive = true;
+        spawns[i].lifetime = 100.0f;
+        spawns[i].position = positions[i];
+        if (std::abs(positions[i].x) <= 1.0f && std::abs(positions[i].y) <= 1.0f) {
+            expected.push_back(positions[i]);
+        }
+    }
+    system.getSpawnQueue().submit(spawns);
+    
+    // Exactly the particles inside are exported, in spawn order
+    system.setCullRect(glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f));
+    system.update(0.0f);
+    REQUIRE(system.getAliveCount() == count);
+    REQUIRE(!expected.empty());
+    REQUIRE(system.getRenderCount() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        REQUIRE(system.getPositions()[i] == expected[i]);
+    }
+}
+
+TEST_CASE("Update statistics", "[particlesystem]") {
+    ps::ParticleSystem system;
+    auto emitter = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+    emitter->setRate(256.0f);
+    emitter->setLifetimeRange(0.75f, 0.75f);
+    system.addEmitter(emitter);
+    system.addEffect(std::make_shared<ps::Wind>(glm::vec2(1.0f, 0.0f)));
+    
+    system.update(0.5f);
+    const ps::UpdateStats& stats = system.stats();
+    if constexpr (!ps::UpdateStats::enabled) {
+        // Nothing is collected and nothing is paid for
+        REQUIRE(stats.spawned == 0);
+        REQUIRE(stats.emitterSpawns.empty());
+        return;
+    }
+    
+    REQUIRE(stats.spawned == 128);
+    REQUIRE(stats.emitterSpawns == std::vector<size_t>{128});
+    REQUIRE(stats.effectVisits == std::vector<size_t>{128});
+    REQUIRE(stats.killed == 0);
+    REQUIRE(stats.capacity >= 128);
+    
+    // The first particles die during the second update
+    system.update(0.5f);
+    REQUIRE(stats.spawned == 128);
+    REQUIRE(stats.killed == 128);
+    REQUIRE(stats.effectVisits == std::vector<size_t>{256});
+    for (double seconds : stats.phaseSeconds) {
+        REQUIRE(seconds >= 0.0);
+    }
+}
+
+TEST_CASE("Memory statistics", "[particlesystem]") {
+    ps::ParticleSystem system;
+    auto emitter = std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f));
+    emitter->setRate(65536.0f);
+    emitter->setLifetimeRange(0.75f, 0.75f);
+    system.addEmitter(emitter);
+    
+    system.update(0.5f);
+    const ps::MemoryStats& memory = system.memoryStats();
+    const ps::ColumnMemory& particles = memory.columns[ps::MemoryStats::Particles];
+    REQUIRE(particles.name == std::string("Particles"));
+    REQUIRE(particles.size == system.getAliveCount());
+    REQUIRE(particles.capacity >= particles.size);
+    REQUIRE(particles.bytes == particles.capacity * sizeof(ps::Particle));
+    REQUIRE(particles.reallocations == 1);
+    REQUIRE(memory.columns[ps::MemoryStats::Positions].size == system.getAliveCount());
+    REQUIRE(memory.columns[ps::MemoryStats::Staging].size > 0);
+    
+    size_t bytes = 0;
+    for (const ps::ColumnMemory& column : memory.columns) {
+        bytes += column.bytes;
+    }
+    REQUIRE(memory.bytes == bytes);
+    REQUIRE(memory.peakBytes == bytes);
+    
+    // Once the particles die the peak remains
+    emitter->setRate(0.0f);
+    system.update(1.0f);
+    system.clearParticles();
+    system.update(0.0f);
+    REQUIRE(particles.size == 0);
+    REQUIRE(memory.peakBytes >= bytes);
+    REQUIRE(particles.peakBytes >= particles.capacity * sizeof(ps::Particle));
+    REQUIRE(particles.totalReallocations >= 1);
+}
+
+TEST_CASE("Timeline trace", "[particlesystem]") {
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / "particlesystem-trace-test.json";
+    const auto readTrace = [&path]() {
+        std::ifstream file(path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    };
+    
+    // Nothing is recorded before tracing is started
+    { ps::trace::Scope scope{"Before start"}; }
+    
+    ps::trace::start();
+    REQUIRE(ps::trace::active());
+    { ps::trace::Scope scope{"Main scope"}; }
+    std::thread worker([]() {
+        ps::trace::setThreadName("Test worker");
+        ps::trace::Scope scope{"Worker scope"};
+    });
+    worker.join();
+    
+    ps::ParticleSystem system;
+    system.addEmitter(std::make_shared<ps::UniformEmitter>(glm::vec2(0.0f, 0.0f)));
+    system.update(0.015625f);
+    ps::trace::stop();
+    { ps::trace::Scope scope{"After stop"}; }
+    
+    ps::trace::write(path.string());
+    std::string trace = readTrace();
+    REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"Main scope\",\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(trace.find("Worker scope") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"Test worker\"") != std::string::npos);
+    REQUIRE(trace.find("Before start") == std::string::npos);
+    REQUIRE(trace.find("After stop") == std::string::npos);
+#ifdef PARTICLESYSTEM_TRACE
+    REQUIRE(trace.find("ParticleSystem::update") != std::string::npos);
+    REQUIRE(trace.find("Emitter::emit") != std::string::npos);
+#endif
+    
+    // A trace limited to a number of frames writes itself when they are done
+    std::filesystem::remove(path);
+    ps::trace::start(path.string(), 2);
+    ps::trace::frame();
+    { ps::trace::Scope scope{"Frame scope"}; }
+    REQUIRE(!std::filesystem::exists(path));
+    ps::trace::frame();
+    REQUIRE(!ps::trace::active());
+    trace = readTrace();
+    REQUIRE(trace.find("Frame scope") != std::string::npos);
+    REQUIRE(trace.find("Main scope") == std::string::npos);
+    REQUIRE(trace.find("\"ph\":\"i\"") != std::string::npos);
+
+    // Names are escaped for JSON
+    ps::trace::start();
+    std::thread quoted([]() {
+        ps::trace::setThreadName("Worker \"A\" \\ 1");
+        ps::trace::Scope scope{"Quoted scope"};
+    });
+    quoted.join();
+    ps::trace::stop();
+    ps::trace::write(path.string());
+    trace = readTrace();
+    REQUIRE(trace.find("\"name\":\"Worker \\\"A\\\" \\\\ 1\"") != std::string::npos);
+
+    // A trace that cannot be written when its frames are done is reported, not thrown
+    ps::trace::start((path.parent_path() / "missing" / "trace.json").string(), 1);
+    REQUIRE_NOTHROW(ps::trace::frame());
+    REQUIRE(!ps::trace::active());
+    std::filesystem::remove(path);
+}
@@ -1,5 +1,6 @@
 #include <catch2/catch_all.hpp>
 #include <glm/glm.hpp>
+#include <numeric>
 
 #include <example/randomsystem.h>
 
@@ -175,3 +176,31 @@ TEST_CASE("Benchmark system update", "[.benchmark]") {
         BENCHMARK("100'000 particles") { return system4.update(0.1, 1.0); };
     }
 }
+
+TEST_CASE("Batch random numbers", "[random]") {
+    particlesystem::BatchRng rng{123};
+
+    std::vector<float> values(1001);
+    rng.uniform(values, -2.0f, 3.0f);
+    REQUIRE(std::ranges::all_of(values, [](float v) { return v >= -2.0f && v < 3.0f; }));
+
+    // The mean of many uniform numbers should be close to the center of the range
+    const float mean = std::accumulate(values.begin(), values.end(), 0.0f) /
+                       static_cast<float>(values.size());
+    REQUIRE_THAT(mean, Catch::Matchers::WithinAbs(0.5f, 0.2f));
+
+    std::vector<glm::vec2> directions(37);
+    rng.unitVectors(directions, 0.0f, 6.2831853f);
+    REQUIRE(std::ranges::all_of(directions, [](const glm::vec2& d) {
+        return std::abs(glm::length(d) - 1.0f) < 1e-5f;
+    }));
+
+    // Reseeding restarts the sequence
+    std::vector<float> first(16);
+    std::vector<float> second(16);
+    rng.seed(7);
+    rng.uniform(first);
+    rng.seed(7);
+    rng.uniform(second);
+    REQUIRE(first == second);
+}
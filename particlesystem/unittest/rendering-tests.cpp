@@ -0,0 +1,247 @@
+#include <catch2/catch_test_macros.hpp>
+#include <rendering/software_rasterizer.h>
+#include <rendering/density_grid.h>
+#include <rendering/frame_recorder.h>
+#include <particlesystem/random.h>
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Straightforward per pixel version of the point rules, one point after the other
+std::vector<float> referenceImage(int width, int height, glm::vec4 background,
+                                  const std::vector<rendering::PointVertex>& points) {
+    std::vector<float> image(static_cast<size_t>(width * height) * 4);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = background[static_cast<int>(i % 4)];
+    }
+
+    for (const auto& point : points) {
+        const float px = (point.position.x + 1.0f) * 0.5f * static_cast<float>(width);
+        const float py = (1.0f - point.position.y) * 0.5f * static_cast<float>(height);
+        const float radius = 0.5f * point.scale;
+        const float color[4] = {static_cast<float>(point.color & 0xFF) / 255.0f,
+                                static_cast<float>((point.color >> 8) & 0xFF) / 255.0f,
+                                static_cast<float>((point.color >> 16) & 0xFF) / 255.0f,
+                                static_cast<float>(point.color >> 24) / 255.0f};
+
+        // Pixels outside the bounding box of the point cannot be covered
+        const int x0 = std::max(static_cast<int>(std::floor(px - radius)) - 1, 0);
+        const int x1 = std::min(static_cast<int>(std::floor(px + radius)) + 1, width - 1);
+        const int y0 = std::max(static_cast<int>(std::floor(py - radius)) - 1, 0);
+        const int y1 = std::min(static_cast<int>(std::floor(py + radius)) + 1, height - 1);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                const float dx = static_cast<float>(x) + 0.5f - px;
+                const float dy = static_cast<float>(y) + 0.5f - py;
+                const bool covered =
+                    point.scale > 1.0f
+                        ? dx * dx + dy * dy <= radius * radius
+                        : x == static_cast<int>(std::floor(px)) && y == static_cast<int>(std::floor(py));
+                if (covered) {
+                    float* pixel = &image[static_cast<size_t>(y * width + x) * 4];
+                    for (int c = 0; c < 4; ++c) {
+                        pixel[c] += (color[c] - pixel[c]) * color[3];
+                    }
+                }
+            }
+        }
+    }
+    return image;
+}
+
+}  // namespace
+
+TEST_CASE("Software rasterizer matches the point rules", "[rendering]") {
+    constexpr int width = 150;
+    constexpr int height = 100;
+    const glm::vec4 background(0.1f, 0.2f, 0.3f, 1.0f);
+
+    // Overlapping translucent points of many sizes, some crossing tile and image borders.
+    // Enough of them to bin on all threads and merge the bins of the threads.
+    particlesystem::BatchRng rng{3};
+    constexpr size_t count = 4 * rendering::SoftwareRasterizer::minPointsPerThread + 2000;
+    std::vector<rendering::PointVertex> points(count);
+    for (auto& point : points) {
+        point.position = {rng.next(-1.1f, 1.1f), rng.next(-1.1f, 1.1f)};
+        point.scale = rng.next(0.5f, 30.0f);
+        point.color = rendering::packColor({rng.next(), rng.next(), rng.next(), rng.next()});
+    }
+
+    rendering::SoftwareRasterizer rasterizer{width, height};
+    rasterizer.setThreadCount(4);
+    rasterizer.clear(background);
+    rasterizer.drawPoints(points);
+    const std::vector<uint8_t> pixels = rasterizer.readPixels();
+    REQUIRE(pixels.size() == width * height * 4);
+
+    // Allow for rounding of the 8-bit output
+    const std::vector<float> expected = referenceImage(width, height, background, points);
+    int mismatches = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        if (std::abs(static_cast<float>(pixels[i]) - expected[i] * 255.0f) > 1.0f) {
+            ++mismatches;
+        }
+    }
+    REQUIRE(mismatches == 0);
+
+    // Drawing in two batches gives the same image as drawing everything at once
+    rasterizer.clear(background);
+    rasterizer.drawPoints(std::span(points).first(700));
+    rasterizer.drawPoints(std::span(points).subspan(700));
+    REQUIRE(rasterizer.readPixels() == pixels);
+}
+
+TEST_CASE("Density grid bins particles into pixels", "[rendering]") {
+    constexpr int width = 37;
+    constexpr int height = 23;
+
+    // Enough particles to bin with several threads, some of them off screen
+    particlesystem::BatchRng rng{5};
+    std::vector<glm::vec2> positions(100000);
+    std::vector<glm::vec4> colors(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = {rng.next(-1.2f, 1.2f), rng.next(-1.2f, 1.2f)};
+        colors[i] = {rng.next(), rng.next(), rng.next(), rng.next()};
+    }
+
+    // Serial reference, summed in particle order like every band of the grid
+    std::vector<uint32_t> count(width * height, 0);
+    std::vector<float> weight(width * height, 0.0f);
+    std::vector<glm::vec3> sum(width * height, glm::vec3(0.0f, 0.0f, 0.0f));
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const int x = static_cast<int>(std::floor((positions[i].x + 1.0f) * 0.5f * width));
+        const int y = static_cast<int>(std::floor((1.0f - positions[i].y) * 0.5f * height));
+        if (x < 0 || x >= width || y < 0 || y >= height) {
+            continue;
+        }
+        const size_t cell = static_cast<size_t>(y * width + x);
+        ++count[cell];
+        weight[cell] += colors[i].a;
+        sum[cell] = sum[cell] + glm::vec3(colors[i].r, colors[i].g, colors[i].b) * colors[i].a;
+    }
+
+    rendering::DensityGrid grid{width, height};
+    grid.setThreadCount(4);
+    grid.bin(positions, colors);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t cell = static_cast<size_t>(y * width + x);
+            REQUIRE(grid.count(x, y) == count[cell]);
+            REQUIRE(grid.weight(x, y) == weight[cell]);
+            const glm::vec3 mean = grid.meanColor(x, y);
+            const glm::vec3 expected = sum[cell] * (1.0f / weight[cell]);
+            REQUIRE(std::abs(mean.r - expected.r) < 1e-5f);
+            REQUIRE(std::abs(mean.g - expected.g) < 1e-5f);
+            REQUIRE(std::abs(mean.b - expected.b) < 1e-5f);
+        }
+    }
+
+    // Bands of a different number of threads sum every pixel in the same order
+    rendering::DensityGrid serial{width, height};
+    serial.setThreadCount(1);
+    serial.bin(positions, colors);
+    grid.setThreadCount(3);
+    grid.bin(positions, colors);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            REQUIRE(grid.count(x, y) == serial.count(x, y));
+            REQUIRE(grid.weight(x, y) == serial.weight(x, y));
+        }
+    }
+
+    // Binning again starts from an empty grid, empty pixels are transparent
+    grid.bin(std::span(positions).first(1), std::span(colors).first(1));
+    std::vector<uint8_t> rgba(width * height * 4);
+    grid.toneMap(rgba, 1.0f);
+    size_t covered = 0;
+    for (size_t cell = 0; cell < weight.size(); ++cell) {
+        covered += rgba[4 * cell + 3] > 0 ? 1 : 0;
+    }
+    REQUIRE(covered <= 1);
+    size_t binned = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            binned += grid.count(x, y);
+        }
+    }
+    REQUIRE(binned <= 1);
+
+    // Five accumulators per pixel and a cell for every particle binned so far
+    REQUIRE(grid.memoryBytes() >= width * height * (4 * sizeof(float) + sizeof(uint32_t)) +
+                                      positions.size() * sizeof(uint32_t));
+}
+
+TEST_CASE("Frame recorder writes frames in the background", "[rendering]") {
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / "particlesystem-recorder-test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto readFile = [](const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+    };
+
+    // A 3x2 frame, each pixel has its own color
+    const std::vector<uint8_t> pixels = {1,  2,  3,  255, 4,  5,  6,  255, 7,  8,  9,  255,
+                                         10, 11, 12, 255, 13, 14, 15, 255, 16, 17, 18, 255};
+    {
+        rendering::FrameRecorder ppm{{(dir / "a").string(), rendering::FrameFormat::Ppm, 4, false}};
+        rendering::FrameRecorder png{{(dir / "b").string(), rendering::FrameFormat::Png, 4, false}};
+        rendering::FrameRecorder raw{{(dir / "c").string(), rendering::FrameFormat::Raw, 4, false}};
+        REQUIRE(ppm.submit(pixels, 3, 2, 7));
+        REQUIRE(png.submit(pixels, 3, 2, 7));
+        REQUIRE(raw.submit(pixels, 3, 2, 7));
+    }
+
+    const std::vector<uint8_t> ppm = readFile(dir / "a00007.ppm");
+    const std::string header = "P6\n3 2\n255\n";
+    REQUIRE(ppm.size() == header.size() + 18);
+    for (size_t i = 0; i < 6; ++i) {
+        REQUIRE(ppm[header.size() + 3 * i] == pixels[4 * i]);
+        REQUIRE(ppm[header.size() + 3 * i + 2] == pixels[4 * i + 2]);
+    }
+
+    // Signature, IHDR, one IDAT holding a single stored block and IEND
+    const std::vector<uint8_t> png = readFile(dir / "b00007.png");
+    const size_t rawSize = 2 * (1 + 3 * 4);
+    REQUIRE(png.size() == 8 + (12 + 13) + (12 + 2 + 5 + rawSize + 4) + 12);
+    REQUIRE(png[1] == 'P');
+    REQUIRE(std::equal(pixels.begin(), pixels.begin() + 12, png.begin() + 8 + 25 + 8 + 7 + 1));
+
+    REQUIRE(readFile(dir / "c00007_3x2.raw") == pixels);
+
+    // A full queue drops frames instead of waiting, every frame is accounted for
+    rendering::FrameRecorder recorder{{(dir / "d").string(), rendering::FrameFormat::Raw, 1, true}};
+    for (size_t frame = 0; frame < 50; ++frame) {
+        recorder.submit(recorder.takeBuffer(pixels.size()), 3, 2, frame);
+    }
+    recorder.drop();
+    rendering::RecordingStats stats = recorder.stats();
+    for (int i = 0; i < 1000 && stats.written + stats.dropped < stats.captured; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = recorder.stats();
+    }
+    REQUIRE(stats.captured == 51);
+    REQUIRE(stats.written + stats.dropped == 51);
+    REQUIRE(stats.dropped >= 1);
+    REQUIRE(stats.maxQueueDepth <= 1);
+    REQUIRE(stats.failed == 0);
+
+    // A short write, e.g. on a full disk, is an error and not a written frame
+    if (std::filesystem::exists("/dev/full")) {
+        REQUIRE_THROWS_AS(rendering::writePpm("/dev/full", 3, 2, pixels), std::runtime_error);
+        REQUIRE_THROWS_AS(rendering::writePng("/dev/full", 3, 2, pixels), std::runtime_error);
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,233 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/format.h>
+#include <glm/glm.hpp>
+#include <rendering/window.h>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// These tests draw with OpenGL into a headless window. Without a display server they need
+// GLFW 3.4 with EGL or OSMesa, e.g. Mesa's software renderer. Where no context can be
+// created they are skipped with a warning.
+
+namespace {
+
+constexpr int width = 64;
+constexpr int height = 48;
+
+std::unique_ptr<rendering::Window> openHeadless(rendering::WindowOptions options = {}) {
+    options.headless = true;
+    try {
+        return std::make_unique<rendering::Window>("Test", width, height, options);
+    } catch (const std::runtime_error& e) {
+        WARN("Skipped, no headless OpenGL context: " << e.what());
+        return nullptr;
+    }
+}
+
+// Point i covers the single pixel i modulo the pixel count, row by row from the top, and
+// has the opaque color with its index in the red, green and blue bytes
+rendering::PointVertex indexPoint(size_t i) {
+    const size_t pixel = i % static_cast<size_t>(width * height);
+    const float x = static_cast<float>(pixel % width) + 0.5f;
+    const float y = static_cast<float>(pixel / width) + 0.5f;
+    return {{x / width * 2.0f - 1.0f, 1.0f - y / height * 2.0f},
+            1.0f,
+            static_cast<uint32_t>(i & 0xFFFFFF) | 0xFF000000u};
+}
+
+using Rgba = std::array<uint8_t, 4>;
+
+// Returns the RGBA bytes of pixel (x, y), counted from the top left
+Rgba pixelAt(const std::vector<uint8_t>& rgba, int x, int y) {
+    const size_t i = (static_cast<size_t>(y) * width + static_cast<size_t>(x)) * 4;
+    return {rgba[i], rgba[i + 1], rgba[i + 2], rgba[i + 3]};
+}
+
+// Center of pixel (x, y) in normalized device coordinates
+glm::vec2 pixelCenter(int x, int y) {
+    return {(static_cast<float>(x) + 0.5f) / width * 2.0f - 1.0f,
+            1.0f - (static_cast<float>(y) + 0.5f) / height * 2.0f};
+}
+
+}  // namespace
+
+TEST_CASE("Headless window draws points", "[window]") {
+    auto window = openHeadless();
+    if (!window) {
+        return;
+    }
+    REQUIRE(window->headless());
+    REQUIRE(window->width() == width);
+    REQUIRE(window->height() == height);
+
+    // Two points of 9 pixels, the second one drawn partly over the first
+    const std::vector<glm::vec2> pos = {pixelCenter(20, 20), pixelCenter(24, 20)};
+    const std::vector<float> radius = {9.0f, 9.0f};
+    const std::vector<glm::vec4> color = {{1.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f, 1.0f}};
+
+    window->beginFrame();
+    window->clear({0.0f, 1.0f, 0.0f, 1.0f});
+    window->drawPoints(pos, radius, color);
+    const std::vector<uint8_t> rgba = window->readPixels();
+    window->endFrame();
+
+    REQUIRE(rgba.size() == static_cast<size_t>(width * height) * 4);
+    REQUIRE(pixelAt(rgba, 17, 20) == Rgba{255, 0, 0, 255});
+    REQUIRE(pixelAt(rgba, 22, 20) == Rgba{0, 0, 255, 255});
+    REQUIRE(pixelAt(rgba, 24, 20) == Rgba{0, 0, 255, 255});
+    // Rows are read from the top, outside the points the clear color remains
+    REQUIRE(pixelAt(rgba, 20, 40) == Rgba{0, 255, 0, 255});
+    REQUIRE(pixelAt(rgba, 0, 0) == Rgba{0, 255, 0, 255});
+}
+
+TEST_CASE("Failed headless window leaves GLFW usable", "[window]") {
+    if (!openHeadless()) {
+        return;
+    }
+
+    // Larger than any renderbuffer, creating the window or its framebuffer fails
+    rendering::WindowOptions options;
+    options.headless = true;
+    REQUIRE_THROWS_AS(rendering::Window("Test", 1 << 16, height, options), std::runtime_error);
+
+    // The failed window was cleaned up, so the next one works
+    auto window = openHeadless();
+    REQUIRE(window);
+    window->beginFrame();
+    window->clear({0.0f, 0.0f, 1.0f, 1.0f});
+    const std::vector<uint8_t> rgba = window->readPixels();
+    window->endFrame();
+    REQUIRE(pixelAt(rgba, width / 2, height / 2) == Rgba{0, 0, 255, 255});
+}
+
+TEST_CASE("Headless window dumps frames", "[window]") {
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / "particlesystem-window-test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    rendering::WindowOptions options;
+    options.frameDumpPrefix = (dir / "frame").string();
+    {
+        auto window = openHeadless(options);
+        if (!window) {
+            std::filesystem::remove_all(dir);
+            return;
+        }
+        REQUIRE(window->isRecording());
+        for (int frame = 0; frame < 2; ++frame) {
+            window->beginFrame();
+            window->clear({0.0f, 0.0f, 0.0f, 1.0f});
+            window->drawPoint(pixelCenter(10 + frame, 5), 1.0f, {1.0f, 1.0f, 1.0f, 1.0f});
+            window->endFrame();
+        }
+        // Closing the window writes the frames still in flight
+    }
+
+    for (int frame = 0; frame < 2; ++frame) {
+        const std::filesystem::path path = dir / fmt::format("frame{:05}.ppm", frame);
+        REQUIRE(std::filesystem::exists(path));
+        std::ifstream file(path, std::ios::binary);
+        std::string magic;
+        int w = 0;
+        int h = 0;
+        int maxValue = 0;
+        file >> magic >> w >> h >> maxValue;
+        file.get();
+        REQUIRE(magic == "P6");
+        REQUIRE(w == width);
+        REQUIRE(h == height);
+        REQUIRE(maxValue == 255);
+
+        const std::vector<char> rgb{std::istreambuf_iterator<char>(file), {}};
+        REQUIRE(rgb.size() == static_cast<size_t>(width * height) * 3);
+        // The point moves one pixel to the right per frame
+        for (int x = 9; x <= 12; ++x) {
+            const size_t i = (5 * static_cast<size_t>(width) + static_cast<size_t>(x)) * 3;
+            const bool lit = x == 10 + frame;
+            REQUIRE(static_cast<uint8_t>(rgb[i]) == (lit ? 255 : 0));
+            REQUIRE(static_cast<uint8_t>(rgb[i + 1]) == (lit ? 255 : 0));
+            REQUIRE(static_cast<uint8_t>(rgb[i + 2]) == (lit ? 255 : 0));
+        }
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Both point upload paths draw the same image", "[window]") {
+    // More points than fit the vertex buffer, so they are streamed in several pieces
+    const size_t count = rendering::Window::maxBatchSize() + 1000;
+    const size_t pixels = static_cast<size_t>(width * height);
+
+    for (bool persistent : {true, false}) {
+        rendering::WindowOptions options;
+        options.persistentMapping = persistent;
+        auto window = openHeadless(options);
+        if (!window) {
+            return;
+        }
+        if (!persistent) {
+            REQUIRE_FALSE(window->usesPersistentMapping());
+        }
+
+        window->beginFrame();
+        window->clear({0.0f, 0.0f, 0.0f, 1.0f});
+        window->drawPoints(
+            count,
+            [](std::span<rendering::PointVertex> chunk, size_t first) {
+                for (size_t i = 0; i < chunk.size(); ++i) {
+                    chunk[i] = indexPoint(first + i);
+                }
+            },
+            4);
+        const std::vector<uint8_t> rgba = window->readPixels();
+        window->endFrame();
+
+        // Opaque points are drawn in order, so every pixel shows the last point covering it
+        REQUIRE(rgba.size() == pixels * 4);
+        for (size_t pixel = 0; pixel < pixels; ++pixel) {
+            const size_t last = pixel + (count - 1 - pixel) / pixels * pixels;
+            const uint8_t* p = &rgba[pixel * 4];
+            REQUIRE(p[0] == (last & 0xFF));
+            REQUIRE(p[1] == ((last >> 8) & 0xFF));
+            REQUIRE(p[2] == ((last >> 16) & 0xFF));
+            REQUIRE(p[3] == 0xFF);
+        }
+    }
+}
+
+TEST_CASE("Headless window restarts recording", "[window]") {
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / "particlesystem-restart-test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    auto window = openHeadless();
+    if (!window) {
+        std::filesystem::remove_all(dir);
+        return;
+    }
+    // Every session gets exactly the frames drawn while it was recording
+    for (const char* prefix : {"first", "second"}) {
+        window->startRecording(
+            {(dir / prefix).string(), rendering::FrameFormat::Ppm, 8, false});
+        window->beginFrame();
+        window->clear({0.0f, 0.0f, 0.0f, 1.0f});
+        window->endFrame();
+        window->stopRecording();
+        REQUIRE_FALSE(window->isRecording());
+    }
+    REQUIRE(std::filesystem::exists(dir / "first00000.ppm"));
+    REQUIRE_FALSE(std::filesystem::exists(dir / "first00001.ppm"));
+    REQUIRE_FALSE(std::filesystem::exists(dir / "second00000.ppm"));
+    REQUIRE(std::filesystem::exists(dir / "second00001.ppm"));
+    std::filesystem::remove_all(dir);
+}